@@ -37,7 +37,9 @@ Engine::Engine(const char *file) : file(file) {
         std::string tmp, response = receive();
         if (response == "uciok") break;
         std::stringstream ss(response);
-        ss >> tmp >> tmp;
+        ss >> tmp;
+        if (tmp != "id") continue; // options have a name too
+        ss >> tmp;
         ss.ignore(1);
         if (tmp == "name") getline(ss, name);
         if (tmp == "author") getline(ss, author);
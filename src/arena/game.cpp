@@ -2,9 +2,9 @@
 
 #include "board.hpp"
 #include "logger.hpp"
-#include "timer.hpp"
 #include "utils_ui.hpp"
 
+#include <chrono>
 #include <format>
 
 bool Game::san = true;
@@ -78,10 +78,16 @@ const std::string Game::to_san(const Board &board, const Move move) {
 }
 
 std::ostream &operator<<(std::ostream &os, const Game &game) {
-    static const std::string name[] = {"death", "time forfeit", "rules infraction", "repetition"};
+    // wall clock, the search timer is monotonic and means nothing outside the process
+    const auto date = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+
+    static const std::string name[] = {"death", "time forfeit", "rules infraction", "repetition",
+                                          "fifty moves"};
     os << std::format("[Event \"Match {}\"]", game.match_id);
     os << std::format("\n[Site \"{}\"]", "Stellar Arena");
-    os << std::format("\n[Date \"{}\"]", timer::get_ms());
+    os << std::format("\n[Date \"{}\"]", date);
     os << std::format("\n[Round \"{}\"]", game.id);
     os << std::format("\n[White \"{}\"]", game.get_white());
     os << std::format("\n[Black \"{}\"]", game.get_black());
@@ -11,6 +11,7 @@ class Game {
         Timeout,
         Illegal,
         Repetition,
+        Fifty,
     };
 
     Game(const uint16_t match_id, const std::string &white, const std::string &black, const std::string &fen);
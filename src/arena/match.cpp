@@ -46,7 +46,8 @@ Game Match::play(Settings swhite, Settings sblack, const std::string &fen = Game
         }
         uint64_t time_passed = timer::get_ms() - time_start;
 
-        std::string move_str = response.substr(9);
+        // only the move itself, bestmove may carry a ponder move
+        std::string move_str = response.substr(9, response.find(' ', 9) - 9);
         if ((move = parse_move(list, move_str)) == Move() || !move.make(board)) {
             logger::log(std::format("Match {}: {} illegal {}", id, to_string(turn), (std::string)move));
             game.set_terminate(Game::Illegal);
@@ -54,16 +55,25 @@ Game Match::play(Settings swhite, Settings sblack, const std::string &fen = Game
             break;
         }
 
-        if (rtable.is_repetition(board.get_hash())) {
+        game.play(move);
+
+        if (rtable.is_repetition(board.get_hash(), board.get_halfmove())) {
             logger::log(std::format("Match {}: {} repetition", id, to_string(turn)));
             game.set_terminate(Game::Repetition);
             game.set_draw(true);
             break;
         }
 
+        // mate on the hundredth halfmove still wins, the next turn finds no legal move
+        const bool mate = board.is_check() && !MoveList(board, false, true).size();
+        if (board.get_halfmove() >= 100 && !mate) {
+            logger::log(std::format("Match {}: {} fifty moves", id, to_string(turn)));
+            game.set_terminate(Game::Fifty);
+            game.set_draw(true);
+            break;
+        }
+
         rtable.push_hash(board.get_hash());
-        if (!move.is_repeatable()) rtable.push_null();
-        game.play(move);
 
         if ((turn == WHITE ? swhite.time : sblack.time) <= time_passed) {
             logger::log(std::format("Match {}: {} timeout", id, to_string(turn)));
@@ -72,8 +82,8 @@ Game Match::play(Settings swhite, Settings sblack, const std::string &fen = Game
             break;
         }
 
-        if (turn == WHITE && !swhite.depth) swhite.time -= time_passed;
-        if (turn == BLACK && !sblack.depth) sblack.time -= time_passed;
+        if (turn == WHITE && !swhite.depth) swhite.time += swhite.inc - time_passed;
+        if (turn == BLACK && !sblack.depth) sblack.time += sblack.inc - time_passed;
 
         logger::log(std::format("Match {}: wtime: {}, btime: {}", id, swhite.time, sblack.time),
                     logger::Debug);
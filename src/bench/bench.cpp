@@ -0,0 +1,178 @@
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "attack.hpp"
+#include "board.hpp"
+#include "evaluate.hpp"
+#include "move.hpp"
+#include "movelist.hpp"
+#include "random.hpp"
+#include "timer.hpp"
+#include "utils.hpp"
+
+enum {
+    TIME = 200,     // milliseconds spent repeating each benchmark
+    SAMPLES = 4096, // square and occupancy pairs for the slider attacks
+};
+
+static const char *positions[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+};
+
+// results are accumulated where the compiler can't prove them unused
+U64 sink;
+
+struct Result {
+    std::string name;
+    U64 ops;
+    uint64_t us;
+
+    double ns_per_op() const { return ops ? us * 1000.0 / ops : 0; }
+};
+
+// repeat a pass over the inputs until the time runs out, a pass returns the operations it did
+// setup runs before every pass and isn't timed
+template <typename Pass, typename Setup = void (*)()>
+Result measure(const std::string &name, uint64_t time, Pass pass, Setup setup = []() {}) {
+    U64 ops = 0;
+    uint64_t elapsed = 0;
+    do {
+        setup();
+        const uint64_t start = timer::get_us();
+        ops += pass();
+        elapsed += timer::get_us() - start;
+    } while (elapsed < time);
+    return {name, ops, elapsed};
+}
+
+void usage(const char *program) {
+    std::cout << "Usage: " << program;
+    std::cout << " [-h]";
+    std::cout << " [-j]";
+    std::cout << " [-t milliseconds per benchmark]" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    int c = 0;
+    bool json = false;
+    uint64_t time = TIME;
+    while ((c = getopt(argc, argv, "hjt:")) != -1) {
+        switch (c) {
+        case 'j': json = true; break;
+        case 't':
+            if (atoi(optarg) <= 0) abort();
+            time = atoi(optarg);
+            break;
+        case 'h': usage(argv[0]); return 1;
+        default: usage(argv[0]); abort();
+        }
+    }
+
+    attack::init();
+    zobrist::init();
+
+    // positions and every position a move away, as the search sees them
+    std::vector<Board> boards;
+    std::vector<std::pair<Board, Move>> moves;
+    for (const char *fen : positions) {
+        const Board board(fen);
+        const MoveList list(board);
+        for (int i = 0; i < list.size(); i++) {
+            Board copy = board;
+            moves.push_back({board, list[i]});
+            if (list[i].make(copy)) boards.push_back(copy);
+        }
+    }
+
+    std::vector<std::pair<Square, U64>> sliders;
+    Random random;
+    for (int i = 0; i < SAMPLES; i++)
+        sliders.push_back({static_cast<Square>(i % 64), random() & random()});
+
+    time *= 1000;
+    std::vector<Result> results;
+
+    results.push_back(measure("movegen_all", time, [&]() {
+        for (const Board &board : boards)
+            sink += MoveList(board).size();
+        return boards.size();
+    }));
+
+    results.push_back(measure("movegen_captures", time, [&]() {
+        for (const Board &board : boards)
+            sink += MoveList(board, true).size();
+        return boards.size();
+    }));
+
+    results.push_back(measure("move_make", time, [&]() {
+        for (const auto &[board, move] : moves) {
+            Board copy = board;
+            sink += move.make(copy);
+        }
+        return moves.size();
+    }));
+
+    results.push_back(measure("board_is_check", time, [&]() {
+        for (const Board &board : boards)
+            sink += board.is_check();
+        return boards.size();
+    }));
+
+    results.push_back(measure("attack_rook", time, [&]() {
+        for (const auto &[square, occupancy] : sliders)
+            sink += attack::rook::attack(square, occupancy);
+        return sliders.size();
+    }));
+
+    results.push_back(measure("attack_bishop", time, [&]() {
+        for (const auto &[square, occupancy] : sliders)
+            sink += attack::bishop::attack(square, occupancy);
+        return sliders.size();
+    }));
+
+    results.push_back(measure("zobrist_hash", time, [&]() {
+        for (const Board &board : boards)
+            sink += zobrist::hash(board);
+        return boards.size();
+    }));
+
+    // evaluation caches its results, measure both sides of it
+    const auto evaluate = [&]() {
+        for (const Board &board : boards)
+            sink += evaluate::score_position(board);
+        return boards.size();
+    };
+    results.push_back(measure("evaluate", time, evaluate, evaluate::clear));
+    results.push_back(measure("evaluate_cached", time, evaluate));
+
+    std::cout << std::fixed << std::setprecision(2);
+    if (json) {
+        std::cout << "{\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            std::cout << "    \"" << results[i].name << "\": {";
+            std::cout << "\"ns_per_op\": " << results[i].ns_per_op() << ", ";
+            std::cout << "\"ops\": " << results[i].ops << "}";
+            std::cout << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        std::cout << "}\n";
+    } else {
+        for (const Result &result : results) {
+            std::cout << std::setw(16) << result.name << ": ";
+            std::cout << std::setw(10) << result.ns_per_op() << " ns/op\n";
+        }
+    }
+
+    return 0;
+}
@@ -58,6 +58,14 @@ Board::Board(const std::string &fen) {
 
     enpassant = fen[++i] != '-' ? from_coordinates(fen.substr(i, 2)) : Square::no_sq;
 
+    // halfmove clock is optional, fullmove number is not used
+    const int size = fen.size();
+    i += enpassant != Square::no_sq ? 2 : 1;
+    while (i < size && fen[i] == ' ')
+        i++;
+    while (i < size && isdigit(fen[i]))
+        halfmove = halfmove * 10 + fen[i++] - '0';
+
     hash_pawn = zobrist::hash_pawn(*this);
     hash = zobrist::hash(*this);
 }
@@ -86,6 +94,7 @@ std::ostream &operator<<(std::ostream &os, const Board &board) {
     os << ((board.castle & Board::Castle::WQ) ? 'Q' : '-');
     os << ((board.castle & Board::Castle::BK) ? 'k' : '-');
     os << ((board.castle & Board::Castle::BQ) ? 'q' : '-');
+    os << "\n Halfmove: " << board.halfmove;
     os << "\n     Hash:" << board.hash << "\n\n";
 
     return os;
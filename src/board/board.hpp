@@ -12,6 +12,8 @@
 
 #define start_position "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 "
 
+struct Move;
+
 class Board {
   public:
     enum Castle : uint8_t {
@@ -21,6 +23,13 @@ class Board {
         BQ = 8
     };
 
+    // squares from which each piece type checks the enemy king, and own pieces
+    // whose departure uncovers a check from an own slider
+    struct CheckInfo {
+        U64 squares[6];
+        U64 discover;
+    };
+
     Board() = default;
     Board(const std::string &fen);
 
@@ -32,6 +41,7 @@ class Board {
     [[nodiscard]] inline constexpr Color get_side() const { return side; }
     [[nodiscard]] inline constexpr uint8_t get_castle() const { return castle; }
     [[nodiscard]] inline constexpr Square get_enpassant() const { return enpassant; }
+    [[nodiscard]] inline constexpr uint16_t get_halfmove() const { return halfmove; }
     [[nodiscard]] inline constexpr U64 get_hash_pawn() const { return hash_pawn; }
 
     [[nodiscard]] inline constexpr U64 get_bitboard_color(Color side) const;
@@ -43,10 +53,13 @@ class Board {
     [[nodiscard]] inline constexpr U64 get_bitboard_piece_attacks(Type piece, Color color, Square from) const;
     [[nodiscard]] inline constexpr U64 get_bitboard_piece_moves(Type piece, Color color, Square from) const;
     [[nodiscard]] inline constexpr U64 get_bitboard_square_land(Square land, Type piece, Color side) const;
+    [[nodiscard]] inline constexpr U64 get_bitboard_attackers(Square square, U64 occupancy) const;
 
     [[nodiscard]] inline constexpr Color get_square_piece_color(Square square) const;
     [[nodiscard]] inline constexpr Type get_square_piece_type(Square square) const;
 
+    [[nodiscard]] inline constexpr CheckInfo get_check_info() const;
+
     /* Setters */
 
     inline constexpr void xor_hash(U64 op);
@@ -55,6 +68,7 @@ class Board {
     inline void switch_side();
     inline void and_castle(uint8_t right);
     inline void set_enpassant(Square target);
+    inline constexpr void set_halfmove(uint16_t count);
 
     inline constexpr void pop_bitboard_color(Color color, Square square);
     inline constexpr void set_bitboard_color(Color color, Square square);
@@ -72,6 +86,10 @@ class Board {
     [[nodiscard]] inline constexpr bool is_piece_attack_square(Type type, Color color, Square source,
                                                                Square target) const;
     [[nodiscard]] inline constexpr bool is_check() const;
+    [[nodiscard]] bool gives_check(Move move, const CheckInfo &info) const;
+
+    // whether a pseudo legal move leaves the own king safe, without making it
+    [[nodiscard]] bool is_legal(Move move) const;
 
   private:
     U64 colors[2] = {0};
@@ -81,6 +99,7 @@ class Board {
     Color side = WHITE;
     Square enpassant = Square::no_sq;
     uint8_t castle = 0;
+    uint16_t halfmove = 0;
 };
 
 constexpr U64 Board::get_bitboard_color(Color side) const { return colors[side]; }
@@ -105,6 +124,18 @@ constexpr U64 Board::get_bitboard_square_land(Square land, Type piece, Color sid
     return get_bitboard_piece_attacks(piece, other(side), land) & get_bitboard_piece(piece, side);
 }
 
+constexpr U64 Board::get_bitboard_attackers(Square square, U64 occupancy) const {
+    const U64 bishops = pieces[BISHOP] | pieces[QUEEN];
+    const U64 rooks = pieces[ROOK] | pieces[QUEEN];
+
+    return (attack::attack_pawn(BLACK, square) & get_bitboard_piece(PAWN, WHITE)) |
+           (attack::attack_pawn(WHITE, square) & get_bitboard_piece(PAWN, BLACK)) |
+           (attack::attack(KNIGHT, square, occupancy) & pieces[KNIGHT]) |
+           (attack::attack(BISHOP, square, occupancy) & bishops) |
+           (attack::attack(ROOK, square, occupancy) & rooks) |
+           (attack::attack(KING, square, occupancy) & pieces[KING]);
+}
+
 constexpr Color Board::get_square_piece_color(Square square) const {
     if (bit::get(colors[WHITE], square)) return WHITE;
     if (bit::get(colors[BLACK], square)) return BLACK;
@@ -118,6 +149,37 @@ constexpr Type Board::get_square_piece_type(Square square) const {
     return Type::NO_TYPE;
 }
 
+constexpr Board::CheckInfo Board::get_check_info() const {
+    const auto king = static_cast<Square>(bit::lsb_index(get_bitboard_piece(KING, other(side))));
+    const U64 occupancy = get_bitboard_occupancy();
+    const U64 bishops = (pieces[BISHOP] | pieces[QUEEN]) & colors[side];
+    const U64 rooks = (pieces[ROOK] | pieces[QUEEN]) & colors[side];
+
+    CheckInfo info = {{0}, 0};
+    info.squares[PAWN] = attack::attack_pawn(other(side), king);
+    info.squares[KNIGHT] = attack::attack(KNIGHT, king, occupancy);
+    info.squares[BISHOP] = attack::attack(BISHOP, king, occupancy);
+    info.squares[ROOK] = attack::attack(ROOK, king, occupancy);
+    info.squares[QUEEN] = info.squares[BISHOP] | info.squares[ROOK];
+
+    // a lone piece between a slider and the king is seen from both sides
+    uint8_t square_i = 0;
+    U64 snipers = attack::attack(BISHOP, king, C64(0)) & bishops;
+    bitboard_for_each_bit(square_i, snipers) {
+        const auto square = static_cast<Square>(square_i);
+        info.discover |= info.squares[BISHOP] & attack::attack(BISHOP, square, occupancy);
+    }
+
+    snipers = attack::attack(ROOK, king, C64(0)) & rooks;
+    bitboard_for_each_bit(square_i, snipers) {
+        const auto square = static_cast<Square>(square_i);
+        info.discover |= info.squares[ROOK] & attack::attack(ROOK, square, occupancy);
+    }
+
+    info.discover &= colors[side];
+    return info;
+}
+
 /* Setters */
 
 constexpr void Board::xor_hash(U64 op) { hash ^= op; }
@@ -140,6 +202,8 @@ void Board::set_enpassant(Square target) {
     enpassant = target;
 }
 
+constexpr void Board::set_halfmove(uint16_t count) { halfmove = count; }
+
 constexpr void Board::pop_bitboard_color(Color color, Square square) { bit::pop(colors[color], square); }
 constexpr void Board::set_bitboard_color(Color color, Square square) { bit::set(colors[color], square); }
 constexpr void Board::pop_bitboard_piece(Type type, Square square) { bit::pop(pieces[type], square); }
@@ -0,0 +1,18 @@
+#ifndef STELLAR_BENCH_H
+#define STELLAR_BENCH_H
+
+#include <cstdint>
+
+namespace bench {
+
+enum {
+    DEPTH = 10,
+};
+
+// search a fixed set of positions, total nodes is a signature of the search behaviour
+// a depth outside 1 to MAX_PLY falls back to DEPTH, a stop ends the run early
+void run(int depth = DEPTH);
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,60 @@
+#include "cuckoo.hpp"
+#include "attack.hpp"
+#include "bit.hpp"
+#include "move.hpp"
+#include "zobrist.hpp"
+
+#include <utility>
+
+namespace cuckoo {
+
+// 3668 reversible moves fit comfortably in two slots per key
+enum {
+    SIZE = 8192,
+};
+
+static U64 keys[SIZE];
+static Move moves[SIZE];
+
+inline constexpr U64 hash1(U64 key) { return key & (SIZE - 1); }
+inline constexpr U64 hash2(U64 key) { return (key >> 16) & (SIZE - 1); }
+
+void init(void) {
+    for (const Color color : {WHITE, BLACK}) {
+        for (Type type = KNIGHT; type <= KING; ++type) {
+            for (int s1 = 0; s1 < 64; s1++) {
+                for (int s2 = s1 + 1; s2 < 64; s2++) {
+                    const auto source = static_cast<Square>(s1), target = static_cast<Square>(s2);
+                    if (!bit::get(attack::attack(type, source, 0), target)) continue;
+
+                    Move move(source, target, Move::QUIET);
+                    U64 key = zobrist::key_piece(type, color, source) ^ zobrist::key_piece(type, color, target) ^
+                              zobrist::key_side();
+
+                    // displace entries between their two slots until one lands in an empty one
+                    U64 slot = hash1(key);
+                    while (true) {
+                        std::swap(keys[slot], key);
+                        std::swap(moves[slot], move);
+                        if (move == Move()) break;
+                        slot = slot == hash1(key) ? hash2(key) : hash1(key);
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool is_reversible(const Board &board, U64 key) {
+    U64 slot = hash1(key);
+    if (keys[slot] != key && keys[slot = hash2(key)] != key) return false;
+
+    const U64 occupancy = board.get_bitboard_occupancy();
+    Square source = moves[slot].source(), target = moves[slot].target();
+    if (!bit::get(occupancy, source)) std::swap(source, target);
+
+    if (board.get_square_piece_color(source) != board.get_side()) return false;
+    return bit::get(attack::attack(board.get_square_piece_type(source), source, occupancy), target);
+}
+
+} // namespace cuckoo
@@ -0,0 +1,17 @@
+#ifndef STELLAR_CUCKOO_H
+#define STELLAR_CUCKOO_H
+
+#include "board.hpp"
+#include "utils.hpp"
+
+namespace cuckoo {
+
+// Every reversible piece move, keyed by the hash difference it makes
+void init(void);
+
+// can the side to move play a reversible move that changes the hash by key
+bool is_reversible(const Board &board, U64 key);
+
+} // namespace cuckoo
+
+#endif
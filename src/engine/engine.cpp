@@ -1,17 +1,29 @@
 #include <algorithm>
+#include <array>
 #include <cctype>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <sstream>
+#include <thread>
+
+#ifdef USE_STATS
+#include <iomanip>
+#endif
 
 #include "attack.hpp"
+#include "bench.hpp"
 #include "board.hpp"
+#include "cuckoo.hpp"
 #include "evaluate.hpp"
 #include "move.hpp"
 #include "movelist.hpp"
 #include "piece.hpp"
+#include "profile.hpp"
 #include "repetition.hpp"
 #include "score.hpp"
+#include "see.hpp"
+#include "timeman.hpp"
 #include "timer.hpp"
 #include "uci.hpp"
 #include "utils.hpp"
@@ -19,15 +31,68 @@
 enum {
     FULL_DEPTH = 4,
     REDUCTION_LIMIT = 3,
-    REDUCTION_MOVE = 2
+    REDUCTION_MOVE = 2,
+    REDUCTION_HISTORY = 8192
+};
+
+enum {
+    HISTORY_MAX = 16384
+};
+
+enum {
+    IIR_DEPTH = 4,
+    LMP_DEPTH = 8,
+    PROBCUT_DEPTH = 5,
+    PROBCUT_REDUCTION = 4,
+    PROBCUT_MARGIN = 200
 };
 
 enum {
     WINDOW = 50
 };
 
+enum {
+    CURRMOVE_TIME = 3000000 // microseconds before the root reports its current move
+};
+
 namespace engine {
 
+// natural logarithm usable in constant expressions
+inline constexpr double ln(double x) {
+    int exponent = 0;
+    while (x > 2) x /= 2, exponent++;
+
+    const double y = (x - 1) / (x + 1), y2 = y * y;
+    double sum = 0, term = y;
+    for (int i = 1; i < 32; i += 2, term *= y2)
+        sum += term / i;
+
+    return 2 * sum + exponent * 0.6931471805599453;
+}
+
+using reductions_array = std::array<std::array<uint8_t, MAX_PLY>, MAX_PLY>;
+inline constexpr const reductions_array reductions = []() constexpr -> reductions_array {
+    reductions_array reductions = {{{0}}};
+    for (int depth = 1; depth < MAX_PLY; depth++) {
+        for (int move = 1; move < MAX_PLY; move++) {
+            reductions[depth][move] = 0.75 + ln(depth) * ln(move) / 2.25;
+        }
+    }
+    return reductions;
+}();
+
+// quiet moves searched before the rest are pruned, by improving and depth
+using lmp_array = std::array<std::array<uint8_t, LMP_DEPTH + 1>, 2>;
+inline constexpr const lmp_array lmp = []() constexpr -> lmp_array {
+    lmp_array lmp = {{{0}}};
+    for (int improving = 0; improving < 2; improving++) {
+        for (int depth = 0; depth <= LMP_DEPTH; depth++) {
+            lmp[improving][depth] = (3 + depth * depth) / (2 - improving);
+        }
+    }
+    return lmp;
+}();
+
 struct Hashe {
     enum class Flag : uint8_t {
         Exact,
@@ -39,6 +104,7 @@ struct Hashe {
     uint8_t depth;
     int16_t score;
     Flag flag;
+    int16_t eval;
 };
 
 template <U64 size> class TTable_internal {
@@ -75,7 +141,19 @@ template <U64 size> class TTable_internal {
     }
 #endif
 
-    static int16_t read(const Board &board, int ply, Move *best, int16_t alpha, int16_t beta, uint8_t depth) {
+    // permille of used entries, estimated from the start of the table
+    static uint16_t hashfull() {
+        uint16_t res = 0;
+        for (int i = 0; i < 1000; i++) {
+            if (table[i].key) res++;
+        }
+        return res;
+    }
+
+    static int16_t read(const Board &board, int ply, Move *best, int16_t *eval, int16_t alpha, int16_t beta,
+                        uint8_t depth) {
+        PROFILE_ZONE(TTRead);
+
         U64 hash = board.get_hash();
         const Hashe &phashe = table[hash % size];
 
@@ -84,6 +162,7 @@ template <U64 size> class TTable_internal {
 #endif
 
         if (phashe.key == hash) {
+            *eval = phashe.eval;
             if (phashe.depth >= depth) {
                 int16_t score = phashe.score;
 
@@ -104,8 +183,10 @@ template <U64 size> class TTable_internal {
         return unknown;
     }
 
-    static void write(const Board &board, int ply, Move best, int16_t score, uint8_t depth,
+    static void write(const Board &board, int ply, Move best, int16_t score, int16_t eval, uint8_t depth,
                       Hashe::Flag flag) {
+        PROFILE_ZONE(TTWrite);
+
         U64 hash = board.get_hash();
         Hashe &phashe = table[hash % size];
 
@@ -121,7 +202,7 @@ template <U64 size> class TTable_internal {
         }
 #endif
 
-        phashe = {hash, best, depth, score, flag};
+        phashe = {hash, best, depth, score, flag, eval};
     }
 
   private:
@@ -147,6 +228,7 @@ TTable ttable;
 class PVTable {
   public:
     Move best(uint8_t ply = 0) { return table[0][ply]; }
+    std::vector<Move> line() const { return {table[0], table[0] + length[0]}; }
 
     void start(uint8_t ply) { length[ply] = ply; }
     void store(Move move, uint8_t ply) {
@@ -156,18 +238,17 @@ class PVTable {
         length[ply] = length[ply + 1];
     }
 
-    friend std::ostream &operator<<(std::ostream &os, const PVTable &pvtable);
-
   private:
     Move table[MAX_PLY][MAX_PLY] = {{}};
     uint8_t length[MAX_PLY] = {0};
 };
 
-std::ostream &operator<<(std::ostream &os, const PVTable &pvtable) {
-    for (uint8_t i = 0; i < pvtable.length[0]; i++)
-        os << pvtable.table[0][i] << " ";
-    return os;
-}
+struct SearchStack {
+    Move move;
+    Move killer[2];
+    int16_t staticEval;
+    uint8_t piece;
+};
 
 static const uci::Settings *settings = nullptr;
 static Board board;
@@ -175,13 +256,133 @@ static repetition::Table rtable;
 
 static PVTable pvtable;
 
-static Move killer[2][MAX_PLY];
-static U32 history[12][64];
+// root moves and what the iterations so far learned about them
+struct RootMove {
+    explicit RootMove(Move move) : move(move) {}
+
+    Move move;
+    int16_t score = -SCORE_INFINITY;
+    int16_t previous = -SCORE_INFINITY;
+    U64 nodes = 0;
+    std::vector<Move> pv;
+};
+
+static std::vector<RootMove> roots;
+static uint16_t rootIndex; // lines before it are already reported in this iteration
+
+static SearchStack stack[MAX_PLY + 1];
+static int16_t history[12][64];
+static int16_t history_capture[12][64][6];
+static int16_t history_continuation[2][12][64][12][64];
+static Move countermove[12][64];
 static bool follow_pv;
 static U64 nodes;
 static uint8_t ply;
+static uint8_t seldepth;
+
+#ifdef USE_STATS
+struct Stats {
+    U64 main = 0, quiescence = 0;
+    U64 cutoff = 0, cutoff_first = 0;
+    U64 null = 0, null_cutoff = 0;
+    U64 reduced = 0, researched = 0;
+    U64 pruned_eval = 0, futility = 0, razoring = 0;
+    U64 aspiration = 0;
+    U64 iir = 0;
+
+    Stats &operator+=(const Stats &other) {
+        main += other.main, quiescence += other.quiescence;
+        cutoff += other.cutoff, cutoff_first += other.cutoff_first;
+        null += other.null, null_cutoff += other.null_cutoff;
+        reduced += other.reduced, researched += other.researched;
+        pruned_eval += other.pruned_eval, futility += other.futility, razoring += other.razoring;
+        aspiration += other.aspiration;
+        iir += other.iir;
+        return *this;
+    }
+
+    static double percent(U64 part, U64 whole) { return whole ? 100.0 * part / whole : 0; }
+
+    // single line for info string
+    void info(std::ostream &os) const {
+        os << std::fixed << std::setprecision(1);
+        os << "nodes " << main << " qnodes " << quiescence;
+        os << " cutoffs " << cutoff << " first " << percent(cutoff_first, cutoff) << "%";
+        os << " null " << null << " success " << percent(null_cutoff, null) << "%";
+        os << " lmr " << reduced << " research " << percent(researched, reduced) << "%";
+        os << " pruned eval " << pruned_eval << " futility " << futility << " razoring " << razoring;
+        os << " aspiration " << aspiration << " iir " << iir;
+    }
+
+    void print() const {
+        std::cout << "Search: " << std::endl;
+        std::cout << "\tNodes:      " << main << " main, " << quiescence << " quiescence" << std::endl;
+        std::cout << "\tCutoffs:    " << cutoff << " (" << percent(cutoff_first, cutoff) << "% first move)"
+                  << std::endl;
+        std::cout << "\tNull move:  " << null << " (" << percent(null_cutoff, null) << "% cutoff)" << std::endl;
+        std::cout << "\tLMR:        " << reduced << " (" << percent(researched, reduced) << "% research)"
+                  << std::endl;
+        std::cout << "\tPruned:     " << pruned_eval << " eval, " << futility << " futility, " << razoring
+                  << " razoring" << std::endl;
+        std::cout << "\tAspiration: " << aspiration << " fails" << std::endl;
+        std::cout << "\tIIR:        " << iir << std::endl;
+    }
+};
+
+// counted per search, totals are kept for the report on exit
+static Stats stats, stats_total;
+#endif
+
+// history of the move following the one played offset plies ago, if there was one
+inline int16_t *history_continuation_get(uint8_t offset, uint8_t piece, Square target) {
+    if (ply < offset) return nullptr;
+
+    const SearchStack &prev = stack[ply - offset];
+    if (prev.move == Move()) return nullptr;
+    return &history_continuation[offset - 1][prev.piece][prev.move.target()][piece][target];
+}
+
+inline int history_quiet_get(uint8_t piece, Square target) {
+    int score = history[piece][target];
+    for (uint8_t offset = 1; offset <= 2; offset++) {
+        const int16_t *entry = history_continuation_get(offset, piece, target);
+        if (entry) score += *entry;
+    }
+    return score;
+}
+
+// refutation of the previous move, absent at the root and after a null move
+inline Move *countermove_get() {
+    if (!ply || stack[ply - 1].move == Move()) return nullptr;
+    return &countermove[stack[ply - 1].piece][stack[ply - 1].move.target()];
+}
+
+// gravity keeps entries within HISTORY_MAX and lets recent results dominate
+inline void history_update(int16_t &entry, int bonus) {
+    entry += bonus - entry * std::abs(bonus) / HISTORY_MAX;
+}
 
-U32 inline move_score(const Move move) {
+inline void history_update_quiet(Move move, int bonus) {
+    const uint8_t piece = piece::get_index(board.get_square_piece_type(move.source()), board.get_side());
+    history_update(history[piece][move.target()], bonus);
+    for (uint8_t offset = 1; offset <= 2; offset++) {
+        int16_t *entry = history_continuation_get(offset, piece, move.target());
+        if (entry) history_update(*entry, bonus);
+    }
+}
+
+inline void history_update_capture(Move move, int bonus) {
+    const uint8_t piece = piece::get_index(board.get_square_piece_type(move.source()), board.get_side());
+    const Type captured = move.is_enpassant() ? PAWN : board.get_square_piece_type(move.target());
+    history_update(history_capture[piece][move.target()][captured], bonus);
+}
+
+void history_age(int16_t *table, size_t size) {
+    for (size_t i = 0; i < size; i++)
+        table[i] /= 2;
+}
+
+int inline move_score(const Move move) {
     static constexpr const uint16_t capture[6][6] = {
         // clang-format off
         {105, 205, 305, 405, 505, 605},
@@ -194,16 +395,23 @@ U32 inline move_score(const Move move) {
     };
 
     const Type type = board.get_square_piece_type(move.source());
+    const uint8_t piece = piece::get_index(type, board.get_side());
     if (move.is_capture()) {
-        const Type captured = board.get_square_piece_type(move.target());
-        return capture[type][captured] + 10000;
+        const Type captured = move.is_enpassant() ? PAWN : board.get_square_piece_type(move.target());
+        const int score = capture[type][captured] + history_capture[piece][move.target()][captured] / 64;
+        if (!see::ge(board, move, 0)) return score;
+        return score + 10000;
     }
-    if (killer[0][ply] == move) return 9000;
-    if (killer[1][ply] == move) return 8000;
-    return history[piece::get_index(type, board.get_side())][move.target()];
+    if (stack[ply].killer[0] == move) return 9000;
+    if (stack[ply].killer[1] == move) return 8000;
+    const Move *counter = countermove_get();
+    if (counter && *counter == move) return 7000;
+    return history_quiet_get(piece, move.target()) / 8;
 }
 
 void move_list_sort(MoveList &list, std::vector<int> &score, int crnt) {
+    PROFILE_ZONE(Ordering);
+
     for (int i = crnt + 1; i < list.size(); i++) {
         if (score[crnt] < score[i]) {
             std::swap(list[crnt], list[i]);
@@ -213,6 +421,8 @@ void move_list_sort(MoveList &list, std::vector<int> &score, int crnt) {
 }
 
 std::vector<int> move_list_score(MoveList &list, const Move best) {
+    PROFILE_ZONE(Ordering);
+
     std::vector<int> score(list.size(), 0);
 
     bool best_found = false;
@@ -241,6 +451,8 @@ std::vector<int> move_list_score(MoveList &list, const Move best) {
 }
 
 int stats_move_make(Board &copy, const Move move) {
+    stack[ply].move = move;
+    stack[ply].piece = piece::get_index(board.get_square_piece_type(move.source()), board.get_side());
     copy = board;
     if (!move.make(board)) {
         board = copy;
@@ -248,29 +460,60 @@ int stats_move_make(Board &copy, const Move move) {
     }
     ply++;
     rtable.push_hash(copy.get_hash());
-    if (!move.is_repeatable()) rtable.push_null();
     return 1;
 }
 
 void stats_move_make_pruning(Board &copy) {
+    stack[ply].move = Move();
     copy = board;
     board.switch_side();
     board.set_enpassant(Square::no_sq);
+    // positions before a null move are not reachable by real moves
+    board.set_halfmove(0);
+    rtable.push_hash(copy.get_hash());
     ply++;
 }
 
 void stats_move_unmake_pruning(Board &copy) {
     board = copy;
+    rtable.pop();
     ply--;
 }
 
-void stats_move_unmake(Board &copy, const Move move) {
+void stats_move_unmake(Board &copy) {
     board = copy;
-    if (!move.is_repeatable()) rtable.pop();
     rtable.pop();
     ply--;
 }
 
+bool has_legal() {
+    const MoveList list(board);
+    for (int i = 0; i < list.size(); i++)
+        if (board.is_legal(list[i])) return true;
+    return false;
+}
+
+// root searches only the lines not reported yet in this iteration
+void root_list(MoveList &list, std::vector<int> &score, const Move best) {
+    for (size_t i = rootIndex; i < roots.size(); i++)
+        list.push(roots[i].move);
+
+    // the hash move may belong to an earlier line, lead with this line's last best
+    score = move_list_score(list, best);
+    if (list.size() && roots[rootIndex].nodes) score[0] = 30001;
+}
+
+RootMove &root_find(const Move move) {
+    return *std::find_if(roots.begin(), roots.end(), [move](const RootMove &root) { return root.move == move; });
+}
+
+// exact scores first, the rest by the effort spent refuting them
+void root_sort(size_t start, size_t end) {
+    std::stable_sort(roots.begin() + start, roots.begin() + end, [](const RootMove &a, const RootMove &b) {
+        return a.score != b.score ? a.score > b.score : a.nodes > b.nodes;
+    });
+}
+
 int16_t quiescence(int16_t alpha, int16_t beta) {
     pvtable.start(ply);
     if ((nodes & 2047) == 0) {
@@ -279,34 +522,77 @@ int16_t quiescence(int16_t alpha, int16_t beta) {
     }
 
     nodes++;
+    seldepth = std::max(seldepth, ply);
+#ifdef USE_STATS
+    stats.quiescence++;
+#endif
+
+    if (ply > MAX_PLY - 1) return evaluate::score_position(board);
+
+    int pv_node = (beta - alpha) > 1;
+    Hashe::Flag flag = Hashe::Flag::Alpha;
+    Move bestMove;
+
+    int16_t staticEval = TTable::unknown;
+    int score = ttable.read(board, ply, &bestMove, &staticEval, alpha, beta, 0);
+    if (score != TTable::unknown && !pv_node) return score;
+
+    // when in check every evasion is searched and there is no stand pat
+    const bool isCheck = board.is_check();
+    if (isCheck) staticEval = TTable::unknown;
+    else {
+        if (staticEval == TTable::unknown) staticEval = evaluate::score_position(board);
+        if (staticEval >= beta) {
+            ttable.write(board, ply, bestMove, beta, staticEval, 0, Hashe::Flag::Beta);
+            return beta;
+        }
+        if (staticEval > alpha) alpha = staticEval;
+    }
 
-    int score = evaluate::score_position(board);
-    if (ply > MAX_PLY - 1) return score;
-    if (score >= beta) return beta;
-    if (score > alpha) alpha = score;
+    static constexpr const int16_t margin_delta = 200;
+    uint8_t legal_moves = 0;
 
     Board copy;
-    MoveList list(board, true);
-    std::vector<int> listScore = move_list_score(list, Move());
+    MoveList list(board, !isCheck);
+    std::vector<int> listScore = move_list_score(list, bestMove);
     for (int i = 0; i < list.size(); i++) {
         move_list_sort(list, listScore, i);
         const Move move = list[i];
+
+        if (!isCheck) {
+            // delta pruning
+            const Type captured = move.is_enpassant() ? PAWN : board.get_square_piece_type(move.target());
+            if (!move.is_promote() && staticEval + score::get(captured) + margin_delta <= alpha) continue;
+
+            if (!see::ge(board, move, 0)) continue;
+        }
+
         if (!stats_move_make(copy, move)) continue;
+        legal_moves++;
         score = -quiescence(-beta, -alpha);
-        stats_move_unmake(copy, move);
+        stats_move_unmake(copy);
 
         if (settings->stopped) return 0;
         if (score > alpha) {
             alpha = score;
+            flag = Hashe::Flag::Exact;
+            bestMove = move;
             pvtable.store(move, ply);
-            if (score >= beta) return beta;
+
+            if (score >= beta) {
+                ttable.write(board, ply, bestMove, beta, staticEval, 0, Hashe::Flag::Beta);
+                return beta;
+            }
         }
     }
 
+    if (isCheck && legal_moves == 0) return -MATE_VALUE + ply;
+
+    ttable.write(board, ply, bestMove, alpha, staticEval, 0, flag);
     return alpha;
 }
 
-int16_t negamax(int16_t alpha, int16_t beta, uint8_t depth, bool null) {
+int16_t negamax(int16_t alpha, int16_t beta, uint8_t depth, bool null, bool cut) {
     int pv_node = (beta - alpha) > 1;
     Hashe::Flag flag = Hashe::Flag::Alpha;
     int futility = 0;
@@ -319,10 +605,25 @@ int16_t negamax(int16_t alpha, int16_t beta, uint8_t depth, bool null) {
         if (settings->stopped) return 0;
     }
 
-    // && fifty >= 100
-    if (ply && rtable.is_repetition(board.get_hash())) return 0;
+    seldepth = std::max(seldepth, ply);
+#ifdef USE_STATS
+    stats.main++;
+#endif
+
+    // the hundredth halfmove draws, unless it delivered mate
+    if (ply && board.get_halfmove() >= 100 && (!board.is_check() || has_legal())) return 0;
+    if (ply && rtable.is_repetition(board.get_hash(), board.get_halfmove())) return 0;
+
+    // a reversible move reaches an earlier position, so the draw is at least available
+    if (ply && alpha < 0 && rtable.is_cycle(board.get_hash(), board.get_halfmove(), [](U64 key) {
+            return cuckoo::is_reversible(board, key);
+        })) {
+        alpha = 0;
+        if (alpha >= beta) return alpha;
+    }
 
-    int16_t score = ttable.read(board, ply, &bestMove, alpha, beta, depth);
+    int16_t staticEval = TTable::unknown;
+    int16_t score = ttable.read(board, ply, &bestMove, &staticEval, alpha, beta, depth);
     if (ply && score != TTable::unknown && !pv_node) return score;
 
     bool isCheck = board.is_check();
@@ -330,9 +631,7 @@ int16_t negamax(int16_t alpha, int16_t beta, uint8_t depth, bool null) {
 
     if (depth == 0) {
         nodes++;
-        int16_t score = quiescence(alpha, beta);
-        // ttable_write(board, ply, bestMove, score, depth, HasheFlag::Exact);
-        return score;
+        return quiescence(alpha, beta);
     }
 
     if (alpha < -MATE_VALUE) alpha = -MATE_VALUE;
@@ -340,14 +639,28 @@ int16_t negamax(int16_t alpha, int16_t beta, uint8_t depth, bool null) {
     if (alpha >= beta) return alpha;
     // if (ply > MAX_PLY - 1) return evaluate::score_position(board);
 
+    // static evaluation is reused from the transposition table when present
+    if (isCheck) staticEval = TTable::unknown;
+    else if (staticEval == TTable::unknown)
+        staticEval = evaluate::score_position(board);
+    stack[ply].staticEval = staticEval;
+
+    // compare with the evaluation of the same side two plies ago
+    const bool improving = !isCheck && (ply < 2 || stack[ply - 2].staticEval == TTable::unknown ||
+                                        staticEval > stack[ply - 2].staticEval);
+
     if (!pv_node && !isCheck) {
         static constexpr const U32 score_pawn = score::get(PAWN);
-        int16_t staticEval = evaluate::score_position(board);
 
         // evaluation pruning
         if (depth < 3 && abs(beta - 1) > -MATE_VALUE + 100) {
-            int16_t marginEval = score_pawn * depth;
-            if (staticEval - marginEval >= beta) return staticEval - marginEval;
+            int16_t marginEval = score_pawn * depth - improving * score_pawn / 2;
+            if (staticEval - marginEval >= beta) {
+#ifdef USE_STATS
+                stats.pruned_eval++;
+#endif
+                return staticEval - marginEval;
+            }
         }
 
         if (settings->stopped) return 0;
@@ -356,22 +669,60 @@ int16_t negamax(int16_t alpha, int16_t beta, uint8_t depth, bool null) {
             // null move pruning
             if (ply && depth > 2 && staticEval >= beta) {
                 stats_move_make_pruning(copy);
-                score = -negamax(-beta, -beta + 1, depth - 1 - REDUCTION_MOVE, false);
+                score = -negamax(-beta, -beta + 1, depth - 1 - REDUCTION_MOVE, false, !cut);
                 stats_move_unmake_pruning(copy);
+#ifdef USE_STATS
+                stats.null++;
+                if (score >= beta) stats.null_cutoff++;
+#endif
                 if (score >= beta) return beta;
             }
 
             // razoring
             score = staticEval + score_pawn;
-            int16_t scoreNew = quiescence(alpha, beta);
-
             if (score < beta && depth == 1) {
+                int16_t scoreNew = quiescence(alpha, beta);
+#ifdef USE_STATS
+                stats.razoring++;
+#endif
                 return (scoreNew > score) ? scoreNew : score;
             }
 
             score += score_pawn;
             if (score < beta && depth < 4) {
-                if (scoreNew < beta) return (scoreNew > score) ? scoreNew : score;
+                int16_t scoreNew = quiescence(alpha, beta);
+                if (scoreNew < beta) {
+#ifdef USE_STATS
+                    stats.razoring++;
+#endif
+                    return (scoreNew > score) ? scoreNew : score;
+                }
+            }
+        }
+
+        // ProbCut: a good capture beating beta by a margin at reduced depth
+        const int16_t betaProbCut = beta + PROBCUT_MARGIN - improving * score_pawn / 2;
+        if (depth >= PROBCUT_DEPTH && abs(beta) < MATE_SCORE) {
+            MoveList list(board, true);
+            std::vector<int> listScore = move_list_score(list, bestMove);
+            for (int i = 0; i < list.size(); i++) {
+                move_list_sort(list, listScore, i);
+                const Move move = list[i];
+                if (!see::ge(board, move, betaProbCut - staticEval)) continue;
+                if (!stats_move_make(copy, move)) continue;
+
+                // verify with quiescence before the reduced search
+                score = -quiescence(-betaProbCut, -betaProbCut + 1);
+                if (score >= betaProbCut)
+                    score = -negamax(-betaProbCut, -betaProbCut + 1, depth - PROBCUT_REDUCTION, true, !cut);
+                stats_move_unmake(copy);
+
+                if (settings->stopped) return 0;
+                if (score >= betaProbCut) {
+                    ttable.write(board, ply, move, beta, staticEval, depth - PROBCUT_REDUCTION + 1,
+                                 Hashe::Flag::Beta);
+                    return beta;
+                }
             }
         }
 
@@ -382,73 +733,163 @@ int16_t negamax(int16_t alpha, int16_t beta, uint8_t depth, bool null) {
             score::get(KNIGHT),
             score::get(ROOK),
         };
-        if (depth < 4 && abs(alpha) < MATE_SCORE && staticEval + margin[depth] <= alpha) futility = 1;
+        const int16_t marginImproving = improving * score_pawn / 2;
+        if (depth < 4 && abs(alpha) < MATE_SCORE && staticEval + margin[depth] + marginImproving <= alpha)
+            futility = 1;
+    }
+
+    // internal iterative reduction: without a hash move ordering is poor, search shallower
+    if ((pv_node || cut) && depth >= IIR_DEPTH && bestMove == Move()) {
+        depth--;
+#ifdef USE_STATS
+        stats.iir++;
+#endif
     }
 
     uint8_t legal_moves = 0;
     uint8_t searched = 0;
 
-    MoveList list(board);
-    std::vector<int> listScore = move_list_score(list, bestMove);
+    Move quiets[MAX_PLY], captures[MAX_PLY];
+    uint8_t quiets_size = 0, captures_size = 0;
+
+    // checks are only needed to guard quiet move pruning and reductions
+    const bool quietPruning = !isCheck;
+    const Board::CheckInfo checkInfo = quietPruning ? board.get_check_info() : Board::CheckInfo();
+
+    MoveList list = ply ? MoveList(board) : MoveList();
+    std::vector<int> listScore;
+    if (ply) listScore = move_list_score(list, bestMove);
+    else
+        root_list(list, listScore, bestMove);
     for (int i = 0; i < list.size(); i++) {
         move_list_sort(list, listScore, i);
         const Move move = list[i];
-        if (!stats_move_make(copy, move)) continue;
-        legal_moves++;
+
+        const bool givesCheck = quietPruning && !move.is_capture() && !move.is_promote() &&
+                                board.gives_check(move, checkInfo);
+
+        // skip captures losing material at low depth
+        if (!pv_node && !isCheck && searched && depth < 4 && move.is_capture() &&
+            !see::ge(board, move, -score::get(PAWN) * depth))
+            continue;
 
         // futility pruning
-        if (futility && searched && !move.is_capture() && !move.is_promote() && !board.is_check()) {
-            stats_move_unmake(copy, move);
+        if (futility && searched && !move.is_capture() && !move.is_promote() && !givesCheck) {
+#ifdef USE_STATS
+            stats.futility++;
+#endif
+            continue;
+        }
+
+        // late move pruning
+        if (!pv_node && !isCheck && depth <= LMP_DEPTH && alpha > -MATE_SCORE && !move.is_capture() &&
+            !move.is_promote() && !givesCheck && searched >= lmp[improving][depth])
             continue;
+
+        // Late Move Reduction
+        int reduction = 0;
+        if (searched >= FULL_DEPTH && depth >= REDUCTION_LIMIT && !isCheck && !givesCheck &&
+            !move.is_capture() && !move.is_promote() && move != stack[ply].killer[0] &&
+            move != stack[ply].killer[1]) {
+            const Type piece = board.get_square_piece_type(move.source());
+            const int moveHistory = history_quiet_get(piece::get_index(piece, board.get_side()), move.target());
+
+            reduction = reductions[std::min<int>(depth, MAX_PLY - 1)][std::min<int>(searched, MAX_PLY - 1)];
+            reduction += !improving + cut - pv_node;
+            reduction -= std::clamp(moveHistory / REDUCTION_HISTORY, -2, 2);
+            reduction = std::clamp(reduction, 0, depth - 2);
+        }
+
+        // long searches tell which root move they are on, every root move is legal
+        if (!ply && timer::get_us() - settings->starttime > CURRMOVE_TIME) {
+            std::ostringstream info;
+            info << "info currmove " << move << " currmovenumber " << rootIndex + legal_moves + 1 << "\n";
+            std::cout << info.str() << std::flush;
         }
 
+        const U64 nodesBefore = nodes;
+        if (!stats_move_make(copy, move)) continue;
+        legal_moves++;
+
         if (!searched) {
-            score = -negamax(-beta, -alpha, depth - 1, true);
+            score = -negamax(-beta, -alpha, depth - 1, true, pv_node ? false : !cut);
         } else {
-            // Late Move Reduction
-            if (!pv_node && searched >= FULL_DEPTH && depth >= REDUCTION_LIMIT && !isCheck &&
-                !move.is_capture() && !move.is_promote() &&
-                (move.source() != killer[0][ply].source() || move.target() != killer[0][ply].target()) &&
-                (move.source() != killer[1][ply].source() || move.target() != killer[1][ply].target())) {
-                score = -negamax(-alpha - 1, -alpha, depth - 2, true);
-            } else
+            if (reduction) score = -negamax(-alpha - 1, -alpha, depth - 1 - reduction, true, true);
+            else
                 score = alpha + 1;
 
+#ifdef USE_STATS
+            if (reduction) {
+                stats.reduced++;
+                if (score > alpha) stats.researched++;
+            }
+#endif
+
             // Principal Variation Search
             if (score > alpha) {
-                score = -negamax(-alpha - 1, -alpha, depth - 1, true);
+                score = -negamax(-alpha - 1, -alpha, depth - 1, true, !cut);
 
                 // if fail research
-                if ((score > alpha) && (score < beta)) score = -negamax(-beta, -alpha, depth - 1, true);
+                if ((score > alpha) && (score < beta)) score = -negamax(-beta, -alpha, depth - 1, true, false);
             }
         }
 
-        stats_move_unmake(copy, move);
+        stats_move_unmake(copy);
         searched++;
 
         if (settings->stopped) return 0;
-        if (score > alpha) {
-            if (!move.is_capture()) {
-                const Type piece = board.get_square_piece_type(move.source());
-                history[piece::get_index(piece, board.get_side())][move.target()] += depth;
-            }
 
+        // only a move that raised alpha has a score worth reporting
+        RootMove *root = ply ? nullptr : &root_find(move);
+        if (root) {
+            root->nodes += nodes - nodesBefore;
+            root->score = -SCORE_INFINITY;
+        }
+
+        if (score > alpha) {
             alpha = score;
             flag = Hashe::Flag::Exact;
             bestMove = move;
             pvtable.store(move, ply);
 
+            if (root) {
+                root->score = score;
+                root->pv = pvtable.line();
+            }
+
             if (score >= beta) {
-                ttable.write(board, ply, bestMove, beta, depth, Hashe::Flag::Beta);
+                ttable.write(board, ply, bestMove, beta, staticEval, depth, Hashe::Flag::Beta);
+#ifdef USE_STATS
+                stats.cutoff++;
+                if (searched == 1) stats.cutoff_first++;
+#endif
 
+                // reward the refutation and penalize the moves tried before it
+                const int bonus = std::min(8 * depth * depth, 1024);
                 if (!move.is_capture()) {
-                    killer[1][ply] = killer[0][ply];
-                    killer[0][ply] = move;
+                    stack[ply].killer[1] = stack[ply].killer[0];
+                    stack[ply].killer[0] = move;
+                    if (Move *counter = countermove_get()) *counter = move;
+
+                    history_update_quiet(move, bonus);
+                    for (uint8_t j = 0; j < quiets_size; j++)
+                        history_update_quiet(quiets[j], -bonus);
+                } else {
+                    history_update_capture(move, bonus);
                 }
 
+                for (uint8_t j = 0; j < captures_size; j++)
+                    history_update_capture(captures[j], -bonus);
+
                 return beta;
             }
         }
+
+        if (move.is_capture()) {
+            if (captures_size < MAX_PLY) captures[captures_size++] = move;
+        } else {
+            if (quiets_size < MAX_PLY) quiets[quiets_size++] = move;
+        }
     }
 
     if (legal_moves == 0) {
@@ -457,87 +898,215 @@ int16_t negamax(int16_t alpha, int16_t beta, uint8_t depth, bool null) {
             return 0;
     }
 
-    ttable.write(board, ply, bestMove, alpha, depth, flag);
+    ttable.write(board, ply, bestMove, alpha, staticEval, depth, flag);
     return alpha;
 }
 
-Move search_position(const uci::Settings &settingsr) {
+U64 get_nodes() { return nodes; }
+
+Move search_position(const uci::Settings &settingsr, Move *ponder) {
     int16_t alpha = -SCORE_INFINITY, beta = SCORE_INFINITY;
     settings = &settingsr;
 
-    if (settings->newgame) ttable.clear();
+    if (settings->newgame) {
+        ttable.clear();
+        evaluate::clear();
+    }
 
     rtable.clear();
     board = settings->board;
     for (int i = 0; i < settings->madeMoves.size(); i++) {
         rtable.push_hash(board.get_hash());
         settings->madeMoves[i].make(board);
-        if (!settings->madeMoves[i].is_repeatable()) rtable.clear();
+        if (!board.get_halfmove()) rtable.clear();
     }
 
     ply = 0;
     nodes = 0;
+#ifdef USE_STATS
+    stats = Stats();
+#endif
     settings->stopped = false;
-    memset(killer, 0x00, sizeof(killer));
-    memset(history, 0x00, sizeof(history));
-    rtable = repetition::Table();
+    std::fill(std::begin(stack), std::end(stack), SearchStack());
+    pvtable = PVTable();
+    if (settings->newgame) {
+        memset(history, 0x00, sizeof(history));
+        memset(history_capture, 0x00, sizeof(history_capture));
+        memset(history_continuation, 0x00, sizeof(history_continuation));
+        memset(countermove, 0x00, sizeof(countermove));
+    } else {
+        history_age(&history[0][0], sizeof(history) / sizeof(int16_t));
+        history_age(&history_capture[0][0][0], sizeof(history_capture) / sizeof(int16_t));
+        history_age(&history_continuation[0][0][0][0][0], sizeof(history_continuation) / sizeof(int16_t));
+    }
+
+    // searchmoves restricts the root, unless none of them is legal
+    roots.clear();
+    const MoveList legal(board, false, true);
+    for (int i = 0; i < legal.size(); i++) {
+        for (int j = 0; j < settings->searchMoves.size(); j++) {
+            if (legal[i] != settings->searchMoves[j]) continue;
+            roots.emplace_back(legal[i]);
+            break;
+        }
+    }
+    if (roots.empty()) {
+        for (int i = 0; i < legal.size(); i++)
+            roots.emplace_back(legal[i]);
+    }
+
+    // a position without legal moves is still searched once for its score
+    const size_t lines = std::clamp<size_t>(settings->multipv, 1, std::max<size_t>(roots.size(), 1));
 
-    Move lastBest;
+    Move lastBest, lastPonder;
+    int16_t lastScore = 0;
+    uint8_t stability = 0;
 
-    uint64_t time_last = timer::get_ms();
     uint8_t max_depth = settings->depth ? settings->depth : MAX_PLY;
     for (uint8_t depth = 1; depth <= max_depth; depth++) {
-        lastBest = pvtable.best();
-        follow_pv = true;
-        int16_t score = negamax(alpha, beta, depth, true);
+        for (RootMove &root : roots)
+            root.previous = root.score;
+        seldepth = 0;
+
+        // assembled first so a reply from the input thread can't split the lines
+        std::ostringstream info;
+        unsigned researches = 0;
+
+        for (rootIndex = 0; rootIndex < lines; rootIndex++) {
+            // each line gets its own window around where it ended last iteration
+            const int16_t previous = rootIndex < roots.size() ? roots[rootIndex].previous : -SCORE_INFINITY;
+            if (depth > 1 && previous != -SCORE_INFINITY) {
+                alpha = std::max(previous - WINDOW, -SCORE_INFINITY);
+                beta = std::min(previous + WINDOW, SCORE_INFINITY);
+            } else {
+                alpha = -SCORE_INFINITY;
+                beta = SCORE_INFINITY;
+            }
 
-        uci::communicate(settings);
-        if (settings->stopped) break;
+            // on fail widen only the failing side, geometrically, around the returned bound
+            int16_t score;
+            for (int delta = WINDOW;; delta *= 2) {
+                follow_pv = true;
+                score = negamax(alpha, beta, depth, true, false);
 
-        if ((score <= alpha) || (score >= beta)) {
-            alpha = -SCORE_INFINITY;
-            beta = SCORE_INFINITY;
-            depth--;
-            continue;
+                uci::communicate(settings);
+                if (settings->stopped) break;
+
+                if (rootIndex < roots.size()) root_sort(rootIndex, roots.size());
+                if (score <= alpha) alpha = std::max(score - delta, -SCORE_INFINITY);
+                else if (score >= beta) beta = std::min(score + delta, SCORE_INFINITY);
+                else break;
+                researches++;
+#ifdef USE_STATS
+                stats.aspiration++;
+#endif
+            }
+            if (settings->stopped) break;
+
+            if (roots.empty()) lastScore = score;
         }
+        if (settings->stopped) break;
+        if (!roots.empty()) root_sort(0, lines);
 
-        alpha = score - WINDOW;
-        beta = score + WINDOW;
+        const uint64_t time = std::max<uint64_t>(timer::get_us() - settings->starttime, 1);
+        const uint16_t hashfull = ttable.hashfull();
 
         uint8_t mate_ply = 0xFF;
-        if (score > -MATE_VALUE && score < -MATE_SCORE) {
-            mate_ply = (score + MATE_VALUE) / 2 + 1;
-            std::cout << "info score mate -" << (int)mate_ply;
-        } else if (score > MATE_SCORE && score < MATE_VALUE) {
-            mate_ply = (MATE_VALUE - score) / 2 + 1;
-            std::cout << "info score mate " << (int)mate_ply;
-        } else {
-            std::cout << "info score cp " << score;
+        for (size_t k = 0; k < lines; k++) {
+            const int16_t score = roots.empty() ? lastScore : roots[k].score;
+
+            uint8_t line_mate = 0xFF;
+            if (score > -MATE_VALUE && score < -MATE_SCORE) {
+                line_mate = (score + MATE_VALUE) / 2 + 1;
+                info << "info score mate -" << (int)line_mate;
+            } else if (score > MATE_SCORE && score < MATE_VALUE) {
+                line_mate = (MATE_VALUE - score) / 2 + 1;
+                info << "info score mate " << (int)line_mate;
+            } else {
+                info << "info score cp " << score;
+            }
+            if (!k) mate_ply = line_mate;
+
+            info << " depth " << (unsigned)depth;
+            info << " seldepth " << (unsigned)seldepth;
+            if (lines > 1) info << " multipv " << k + 1;
+            info << " nodes " << nodes;
+            info << " nps " << nodes * 1000000 / time;
+            info << " hashfull " << hashfull;
+            info << " time " << time / 1000;
+            info << " pv";
+            if (!roots.empty())
+                for (const Move move : roots[k].pv)
+                    info << " " << move;
+            info << "\n";
+        }
+        if (researches) info << "info string aspiration researches " << researches << "\n";
+#ifdef USE_STATS
+        if (settings->debug) {
+            info << "info string stats ";
+            stats.info(info);
+            info << "\n";
         }
+#endif
+        std::cout << info.str() << std::flush;
+
+        if (roots.empty()) break;
 
-        std::cout << " depth " << (unsigned)depth;
-        std::cout << " nodes " << nodes;
-        std::cout << " time " << timer::get_ms() - settings->starttime;
-        std::cout << " pv " << pvtable << std::endl;
+        const int16_t score = roots[0].score;
+        stability = roots[0].move == lastBest ? stability + 1 : 0;
+        const int16_t drop = depth > 1 ? lastScore - score : 0;
+        lastScore = score;
+        lastBest = roots[0].move;
+        lastPonder = roots[0].pv.size() > 1 ? roots[0].pv[1] : Move();
 
         if (depth >= mate_ply) break;
 
-        uint64_t time_crnt = timer::get_ms();
-        if (!settings->depth && 2 * time_crnt - time_last > settings->stoptime) break;
-        time_last = time_crnt;
+        const uint64_t elapsed = timer::get_us() - settings->clocktime;
+        if (!settings->infinite && !settings->ponder &&
+            elapsed > timeman::scale(settings->softtime, stability, drop))
+            break;
+    }
+
+    // bestmove may not be sent while pondering, wait for ponderhit or stop
+    while (settings->ponder && !settings->stopped) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        uci::communicate(settings);
     }
 
     settings->board = board;
-    return !settings->stopped ? pvtable.best() : lastBest;
+#ifdef USE_STATS
+    stats_total += stats;
+#endif
+
+    *ponder = lastPonder;
+    if (lastBest != Move()) return lastBest;
+
+    // stopped before the first iteration finished, take what the root has so far
+    if (!rootIndex && pvtable.best() != Move()) return pvtable.best();
+    return roots.empty() ? Move() : roots[0].move;
 }
 } // namespace engine
 
-int main() {
+int main(int argc, char *argv[]) {
     attack::init();
     zobrist::init();
-    uci::loop();
+    cuckoo::init();
+
+    // engine bench [depth] runs the benchmark instead of the protocol
+    // engine "command" ... runs the commands and waits for the search, for scripts and tests
+    if (argc > 1 && std::string(argv[1]) == "bench") bench::run(argc > 2 ? atoi(argv[2]) : bench::DEPTH);
+    else if (argc > 1) {
+        std::stringstream commands;
+        for (int i = 1; i < argc; i++)
+            commands << argv[i] << "\n";
+        uci::loop(commands, true);
+    } else
+        uci::loop();
 #ifdef USE_STATS
     engine::ttable.print();
+    engine::stats_total.print();
+    evaluate::print();
 #endif
+    profile::print();
     return 0;
 }
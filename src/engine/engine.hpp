@@ -7,10 +7,10 @@
 
 namespace engine {
 
-Move search_position(const uci::Settings &setting);
+Move search_position(const uci::Settings &setting, Move *ponder);
 
-class PVTable;
-std::ostream &operator<<(std::ostream &os, const PVTable &pvtable);
+// nodes visited by the current or the last search
+U64 get_nodes();
 
 } // namespace engine
 
@@ -2,12 +2,19 @@
 #include "bit.hpp"
 #include "bitboard.hpp"
 #include "piece.hpp"
+#include "profile.hpp"
 #include "score.hpp"
 #include "utils.hpp"
 
 #include <array>
-#include <vector>
+#include <atomic>
 #include <numeric>
+#include <vector>
+
+#ifdef USE_STATS
+#include <iomanip>
+#include <iostream>
+#endif
 
 namespace evaluate {
 
@@ -98,6 +105,73 @@ template <U32 SIZE> std::array<Hashe, 2 * SIZE> PTable<SIZE>::table = {{{0}}};
 
 PTable<65537> ptable;
 
+/* Evaluation cache
+ *
+ * Each entry is a single word: upper 48 bits of the full board hash with the
+ * side relative score in the lower 16 bits, so reads and writes can't tear and
+ * no locking is needed.
+ */
+template <U32 SIZE> class ETable {
+    static_assert((SIZE & (SIZE - 1)) == 0, "Evaluation cache size must be a power of two");
+
+  public:
+    static void clear() {
+        for (auto &entry : table)
+            entry.store(0, std::memory_order_relaxed);
+#ifdef USE_STATS
+        accessed = 0, hit = 0;
+#endif
+    }
+
+#ifdef USE_STATS
+    static void print() {
+        std::cout << "Evaluation cache: " << std::endl;
+        std::cout << "\tSize:    " << SIZE << " entries (" << sizeof(U64) << "B per entry)" << std::endl;
+        std::cout << "\tReads:   " << accessed << std::endl;
+        std::cout << "\tHits:    " << hit << "(" << std::fixed << std::setprecision(2)
+                  << (accessed ? (double)hit / accessed * 100 : 0) << "%)" << std::endl;
+    }
+#endif
+
+    [[nodiscard]] static inline bool read(U64 hash, int16_t &score) {
+        const U64 entry = table[hash & (SIZE - 1)].load(std::memory_order_relaxed);
+
+#ifdef USE_STATS
+        accessed++;
+#endif
+
+        if (!entry || ((entry ^ hash) & ~mask)) return false;
+        score = static_cast<int16_t>(entry & mask);
+
+#ifdef USE_STATS
+        hit++;
+#endif
+        return true;
+    }
+
+    static inline void write(U64 hash, int16_t score) {
+        const U64 entry = (hash & ~mask) | static_cast<uint16_t>(score);
+        table[hash & (SIZE - 1)].store(entry, std::memory_order_relaxed);
+    }
+
+  private:
+    static inline constexpr const U64 mask = C64(0xFFFF);
+    static std::array<std::atomic<U64>, SIZE> table;
+
+#ifdef USE_STATS
+    static U64 accessed, hit;
+#endif
+};
+
+template <U32 SIZE> std::array<std::atomic<U64>, SIZE> ETable<SIZE>::table;
+
+#ifdef USE_STATS
+template <U32 SIZE> U64 ETable<SIZE>::accessed = 0;
+template <U32 SIZE> U64 ETable<SIZE>::hit = 0;
+#endif
+
+ETable<C32(1) << 16> etable;
+
 uint16_t score_game_phase(const Board &board) {
     int16_t total = 0;
     for (int type_i = KNIGHT; type_i < KING; type_i++) {
@@ -202,10 +276,23 @@ int16_t score_position_side(const Board &board, const Color side, const uint16_t
 }
 
 int16_t score_position(const Board &board) {
+    PROFILE_ZONE(Evaluate);
+
+    int16_t score = 0;
+    if (etable.read(board.get_hash(), score)) return score;
+
     const uint16_t phase_score = score_game_phase(board);
-    const int16_t score =
-        score_position_side(board, WHITE, phase_score) - score_position_side(board, BLACK, phase_score);
-    return board.get_side() == WHITE ? score : -score;
+    score = score_position_side(board, WHITE, phase_score) - score_position_side(board, BLACK, phase_score);
+    if (board.get_side() == BLACK) score = -score;
+
+    etable.write(board.get_hash(), score);
+    return score;
 }
 
+void clear() { etable.clear(); }
+
+#ifdef USE_STATS
+void print() { etable.print(); }
+#endif
+
 } // namespace evaluate
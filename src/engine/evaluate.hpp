@@ -6,6 +6,11 @@
 namespace evaluate {
 
 int16_t score_position(const Board &board);
+void clear();
+
+#ifdef USE_STATS
+void print();
+#endif
 
 }
 
@@ -0,0 +1,67 @@
+#include "see.hpp"
+#include "attack.hpp"
+#include "bit.hpp"
+#include "score.hpp"
+#include "utils.hpp"
+
+namespace see {
+
+bool ge(const Board &board, Move move, int16_t threshold) {
+    using score::Phase::OPENING;
+
+    if (move.is_castle()) return threshold <= 0;
+
+    const Square source = move.source(), target = move.target();
+    const Type captured = move.is_enpassant() ? PAWN : board.get_square_piece_type(target);
+
+    int swap = (captured != NO_TYPE ? score::get(captured, OPENING) : 0) - threshold;
+    if (swap < 0) return false;
+
+    swap = score::get(board.get_square_piece_type(source), OPENING) - swap;
+    if (swap <= 0) return true;
+
+    U64 occupancy = board.get_bitboard_occupancy();
+    bit::pop(occupancy, source);
+    bit::pop(occupancy, target);
+    if (move.is_enpassant()) bit::pop(occupancy, board.get_enpassant() + (board.get_side() == WHITE ? -8 : 8));
+
+    const U64 bishops = board.get_bitboard_piece(BISHOP) | board.get_bitboard_piece(QUEEN);
+    const U64 rooks = board.get_bitboard_piece(ROOK) | board.get_bitboard_piece(QUEEN);
+
+    U64 attackers = board.get_bitboard_attackers(target, occupancy);
+    Color side = board.get_side();
+    bool res = true;
+
+    while (true) {
+        side = other(side);
+        attackers &= occupancy;
+
+        const U64 attackersSide = attackers & board.get_bitboard_color(side);
+        if (!attackersSide) break;
+        res = !res;
+
+        // least valuable attacker captures next
+        Type type = PAWN;
+        U64 bitboard = 0;
+        for (; type < KING; ++type) {
+            if ((bitboard = attackersSide & board.get_bitboard_piece(type))) break;
+        }
+
+        // the king can only capture if it is not recaptured
+        if (type == KING) return (attackers & ~board.get_bitboard_color(side)) ? !res : res;
+
+        swap = score::get(type, OPENING) - swap;
+        if (swap < res) break;
+
+        bit::pop(occupancy, bit::lsb_index(bitboard));
+
+        // reveal x-ray attackers behind the captured piece
+        if (type == PAWN || type == BISHOP || type == QUEEN)
+            attackers |= attack::attack(BISHOP, target, occupancy) & bishops;
+        if (type == ROOK || type == QUEEN) attackers |= attack::attack(ROOK, target, occupancy) & rooks;
+    }
+
+    return res;
+}
+
+} // namespace see
@@ -0,0 +1,15 @@
+#ifndef STELLAR_SEE_H
+#define STELLAR_SEE_H
+
+#include "board.hpp"
+#include "move.hpp"
+
+namespace see {
+
+// Static Exchange Evaluation: does the exchange on the target square of the
+// move gain at least threshold for the side to move
+bool ge(const Board &board, Move move, int16_t threshold);
+
+} // namespace see
+
+#endif
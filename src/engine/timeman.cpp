@@ -0,0 +1,40 @@
+#include "timeman.hpp"
+
+#include <algorithm>
+
+namespace timeman {
+
+enum {
+    HORIZON = 40,     // moves to plan for in sudden death
+    MINIMUM = 10000,  // enough to finish the first iterations
+    STABILITY = 5,    // iterations with the same best move before the budget stops shrinking
+    DROP = 100,       // score drop that earns the most extra time
+};
+
+Limits allocate(uint64_t time, uint64_t inc, uint64_t movestogo, uint64_t movetime, uint64_t overhead) {
+    if (movetime) {
+        // the minimum yields to overhead, but nothing may outlast what the caller allowed
+        const uint64_t spare = movetime > overhead ? movetime - overhead : 0;
+        const uint64_t limit = std::min<uint64_t>(movetime, std::max<uint64_t>(spare, MINIMUM));
+        return {limit, limit};
+    }
+
+    // clock expected over the horizon, every planned move pays for its communication
+    const int64_t mtg = std::min<uint64_t>(movestogo ? movestogo : (uint64_t)HORIZON, HORIZON);
+    const int64_t left = std::max<int64_t>((int64_t)(time + inc * (mtg - 1)) - (int64_t)overhead * (mtg + 2), 0);
+
+    // never more than the clock actually holds
+    const int64_t ceiling = std::max<int64_t>((int64_t)time * 3 / 4 - (int64_t)overhead, 1000);
+
+    const uint64_t hard = std::min<int64_t>(std::max<int64_t>(left / mtg * 5, MINIMUM), ceiling);
+    const uint64_t soft = std::min<uint64_t>(left / mtg, hard);
+    return {soft, hard};
+}
+
+uint64_t scale(uint64_t soft, uint8_t stability, int16_t drop) {
+    const double unstable = 1.5 - 0.15 * std::min<int>(stability, STABILITY);
+    const double falling = 1.0 + std::clamp<int>(drop, 0, DROP) / (double)(2 * DROP);
+    return soft * unstable * falling;
+}
+
+} // namespace timeman
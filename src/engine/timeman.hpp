@@ -0,0 +1,21 @@
+#ifndef STELLAR_TIMEMAN_H
+#define STELLAR_TIMEMAN_H
+
+#include <cstdint>
+
+namespace timeman {
+
+// all times are in microseconds, measured from the start of the search
+struct Limits {
+    uint64_t soft; // don't start another iteration past it
+    uint64_t hard; // abort the search
+};
+
+Limits allocate(uint64_t time, uint64_t inc, uint64_t movestogo, uint64_t movetime, uint64_t overhead);
+
+// stretch the soft limit while the best move keeps changing or the score is falling
+uint64_t scale(uint64_t soft, uint8_t stability, int16_t drop);
+
+} // namespace timeman
+
+#endif
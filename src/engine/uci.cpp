@@ -1,23 +1,67 @@
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <limits>
 #include <sstream>
 #include <string>
+#include <thread>
 
+#include "bench.hpp"
 #include "engine.hpp"
 #include "stellar_version.hpp"
+#include "timeman.hpp"
 #include "timer.hpp"
 #include "uci.hpp"
 
 namespace uci {
 
+// search runs on its own thread, input thread only raises the flags
+static std::atomic<bool> stop_requested = false;
+static std::atomic<bool> ponderhit = false;
+static std::thread search_thread;
+
+// milliseconds lost between the GUI clock and ours on every move
+static uint64_t overhead = 10;
+
+// options outlive ucinewgame, which resets the settings
+// they reach the search only at go, a running search never sees them change
+static uint16_t multipv = 1;
+static bool debug = false;
+
 void communicate(const uci::Settings *settings) {
-    if (!settings->infinite && timer::get_ms() > settings->stoptime) {
+    if (stop_requested.load(std::memory_order_relaxed)) {
+        settings->stopped = true;
+        return;
+    }
+
+    if (settings->ponder) {
+        if (!ponderhit.load(std::memory_order_relaxed)) return;
+
+        // predicted move was played, our clock starts now
+        settings->clocktime = timer::get_us();
+        settings->ponder = false;
+    }
+
+    if (!settings->infinite && timer::get_us() - settings->clocktime > settings->hardtime) {
+        settings->stopped = true;
+        return;
+    }
+
+    if (settings->nodes && engine::get_nodes() >= settings->nodes) {
         settings->stopped = true;
         return;
     }
 }
 
+inline void search_wait() {
+    if (search_thread.joinable()) search_thread.join();
+}
+
+inline void search_stop() {
+    stop_requested.store(true, std::memory_order_relaxed);
+    search_wait();
+}
+
 inline bool parse_move(const Board &board, Move &move, const std::string &move_string) {
     const Square source = from_coordinates(move_string.substr(0, 2));
     const Square target = from_coordinates(move_string.substr(2, 2));
@@ -36,7 +80,7 @@ inline bool parse_move(const Board &board, Move &move, const std::string &move_s
     return false;
 }
 
-void loop() {
+void loop(std::istream &input, bool finish) {
     static Settings settings;
     static std::string line, command;
     static Move move;
@@ -44,24 +88,59 @@ void loop() {
     Board board;
 
     while (true) {
-        std::getline(std::cin, line);
+        // end of input is a quit, the GUI is gone and nobody is left to send stop
+        if (!std::getline(input, line)) {
+            if (finish) search_wait();
+            else
+                search_stop();
+            break;
+        }
+
         std::istringstream iss(line);
-        iss >> command;
+        if (!(iss >> command)) continue;
         if (command == "quit") {
+            search_stop();
             break;
+        } else if (command == "stop") {
+            search_stop();
+        } else if (command == "bench") {
+            search_stop();
+            int depth = bench::DEPTH;
+            iss >> depth;
+
+            // runs where a search would, so stop and quit still interrupt it
+            stop_requested.store(false, std::memory_order_relaxed);
+            search_thread = std::thread([depth]() { bench::run(depth); });
+        } else if (command == "ponderhit") {
+            ponderhit.store(true, std::memory_order_relaxed);
         } else if (command == "uci") {
             std::cout << "id name Stellar " << getStellarVersion() << "\n";
             std::cout << "id author Dimitrije Dobrota\n";
+            std::cout << "option name Ponder type check default false\n";
+            std::cout << "option name Move Overhead type spin default 10 min 0 max 5000\n";
+            std::cout << "option name MultiPV type spin default 1 min 1 max 256\n";
             std::cout << "uciok\n";
         } else if (command == "debug") {
             iss >> command;
-            settings.debug = (command == "on");
+            debug = (command == "on");
         } else if (command == "isready") {
             std::cout << "readyok\n";
+        } else if (command == "setoption") {
+            // name may span several words
+            std::string name;
+            iss >> command;
+            while (iss >> command && command != "value")
+                name += (name.empty() ? "" : " ") + command;
+
+            if (name == "Move Overhead") iss >> overhead;
+            else if (name == "MultiPV")
+                iss >> multipv;
         } else if (command == "ucinewgame") {
+            search_stop();
             settings = Settings();
             settings.board = Board(start_position);
         } else if (command == "position") {
+            search_stop();
             settings.madeMoves.clear();
             iss >> command;
             if (command == "startpos") {
@@ -81,9 +160,17 @@ void loop() {
                 move.make(board);
             }
         } else if (command == "go") {
+            search_stop();
             settings.searchMoves.clear();
+            settings.ponder = false;
+            settings.infinite = false;
+            settings.mate = false;
+            settings.depth = 0;
+            settings.nodes = 0;
+            settings.multipv = multipv;
+            settings.debug = debug;
             uint64_t wtime = 0, btime = 0, movetime = 0;
-            uint64_t winc = 0, binc = 0, movestogo = 40;
+            uint64_t winc = 0, binc = 0, movestogo = 0;
 
             while (iss >> command) {
                 if (command == "wtime") iss >> wtime;
@@ -115,30 +202,27 @@ void loop() {
                 }
             }
 
-            auto time_left = board.get_side() == WHITE ? wtime : btime;
-            int64_t time = 0;
-
-            if (movetime != 0) {
-                time = movetime;
-                movestogo = 1;
-            } else if (time_left != 0) {
-                auto inc = board.get_side() == WHITE ? winc : binc;
-                time = time_left / movestogo + inc / 2;
-                if (time > time_left) time = time_left - 500;
-                if (time <= 0) time = 100;
-
-                settings.infinite = false;
-            } else {
-                settings.infinite = true;
-            }
-
-            settings.starttime = timer::get_ms();
-            settings.stoptime = settings.starttime + time;
-
-            const Move best = engine::search_position(settings);
-            std::cout << "bestmove " << best << '\n';
-
-            settings.newgame = false;
+            const uint64_t time = board.get_side() == WHITE ? wtime : btime;
+            const uint64_t inc = board.get_side() == WHITE ? winc : binc;
+            if (!movetime && !time) settings.infinite = true;
+
+            const timeman::Limits limits =
+                timeman::allocate(time * 1000, inc * 1000, movestogo, movetime * 1000, overhead * 1000);
+            settings.softtime = limits.soft;
+            settings.hardtime = limits.hard;
+            settings.starttime = settings.clocktime = timer::get_us();
+
+            stop_requested.store(false, std::memory_order_relaxed);
+            ponderhit.store(false, std::memory_order_relaxed);
+            search_thread = std::thread([]() {
+                Move ponder;
+                const Move best = engine::search_position(settings, &ponder);
+                std::string response = "bestmove " + (std::string)best;
+                if (ponder != Move()) response += " ponder " + (std::string)ponder;
+                std::cout << response + "\n" << std::flush;
+
+                settings.newgame = false;
+            });
         }
     }
 }
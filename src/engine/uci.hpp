@@ -1,6 +1,8 @@
 #ifndef STELLAR_UCI_H
 #define STELLAR_UCI_H
 
+#include <iostream>
+
 #include "board.hpp"
 #include "move.hpp"
 #include "movelist.hpp"
@@ -16,12 +18,16 @@ struct Settings {
     MoveList searchMoves;
     MoveList madeMoves;
 
-    uint64_t starttime;
-    uint64_t stoptime;
+    // microseconds, limits are relative to the clock, which starts later on a ponderhit
+    mutable uint64_t starttime;
+    mutable uint64_t clocktime;
+    uint64_t softtime;
+    uint64_t hardtime;
     uint16_t depth = 0;
 
     uint32_t nodes = 0;
-    bool ponder = false;
+    uint16_t multipv = 1;
+    mutable bool ponder = false;
     bool debug = false;
     bool mate = false;
     bool infinite = true;
@@ -30,8 +36,8 @@ struct Settings {
     mutable bool stopped = false;
 };
 
-void loop();
-uint32_t get_time_ms();
+// at the end of input a running search is stopped, or left to finish for commands given up front
+void loop(std::istream &input = std::cin, bool finish = false);
 void communicate(const uci::Settings *settings);
 
 } // namespace uci
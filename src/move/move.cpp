@@ -1,4 +1,5 @@
 #include "move.hpp"
+#include "profile.hpp"
 #include "utils.hpp"
 #include "utils_ui.hpp"
 
@@ -28,6 +29,8 @@ using Type::PAWN;
 using Type::ROOK;
 
 bool Move::make(Board &board) const {
+    PROFILE_ZONE(Make);
+
     static constexpr const int castling_rights[64] = {
         // clang-format off
         13, 15, 15, 15, 12, 15, 15, 14,
@@ -71,6 +74,7 @@ bool Move::make(Board &board) const {
     }
 
     board.set_enpassant(is_double() ? ntarget : Square::no_sq);
+    board.set_halfmove(piece == PAWN || is_capture() ? 0 : board.get_halfmove() + 1);
 
     if (is_castle()) {
         if (color == Color::WHITE) {
@@ -91,6 +95,68 @@ bool Move::make(Board &board) const {
     return false;
 }
 
+bool Board::gives_check(Move move, const CheckInfo &info) const {
+    const Square source = move.source(), target = move.target();
+    const Type type = move.is_promote() ? move.promoted() : get_square_piece_type(source);
+    const U64 king = get_bitboard_piece(KING, other(side));
+
+    U64 occupancy = get_bitboard_occupancy();
+    bit::pop(occupancy, source);
+    bit::set(occupancy, target);
+
+    // direct check, promotion may attack through the square it left
+    if (move.is_promote()) {
+        if (attack::attack(type, target, occupancy) & king) return true;
+    } else if (bit::get(info.squares[type], target)) {
+        return true;
+    }
+
+    if (move.is_castle()) {
+        const bool white = side == Color::WHITE;
+        const Square rook_source = move.is_castle_king() ? (white ? Square::h1 : Square::h8)
+                                                         : (white ? Square::a1 : Square::a8);
+        const Square rook_target = move.is_castle_king() ? (white ? Square::f1 : Square::f8)
+                                                         : (white ? Square::d1 : Square::d8);
+        bit::pop(occupancy, rook_source);
+        bit::set(occupancy, rook_target);
+        return attack::attack(ROOK, rook_target, occupancy) & king;
+    }
+
+    // discovered check, en passant also clears the captured pawn's square
+    if (move.is_enpassant()) bit::pop(occupancy, target + (side == Color::WHITE ? -8 : +8));
+    else if (!bit::get(info.discover, source))
+        return false;
+
+    const auto square = static_cast<Square>(bit::lsb_index(king));
+    const U64 own = colors[side] & ~(C64(1) << source);
+    return (attack::attack(BISHOP, square, occupancy) & (pieces[BISHOP] | pieces[QUEEN]) & own) ||
+           (attack::attack(ROOK, square, occupancy) & (pieces[ROOK] | pieces[QUEEN]) & own);
+}
+
+bool Board::is_legal(Move move) const {
+    // rare enough to settle by making them
+    if (move.is_castle() || move.is_enpassant()) {
+        Board copy = *this;
+        return move.make(copy);
+    }
+
+    const Square source = move.source(), target = move.target();
+    const U64 king = get_bitboard_piece(KING, side);
+    const auto square = bit::get(king, source) ? target : static_cast<Square>(bit::lsb_index(king));
+
+    U64 occupancy = get_bitboard_occupancy();
+    bit::pop(occupancy, source);
+    bit::set(occupancy, target);
+
+    // a captured piece attacks no more
+    const U64 enemy = colors[other(side)] & ~(C64(1) << target);
+    return !((attack::attack_pawn(side, square) & pieces[PAWN] & enemy) ||
+             (attack::attack(KNIGHT, square, occupancy) & pieces[KNIGHT] & enemy) ||
+             (attack::attack(KING, square, occupancy) & pieces[KING] & enemy) ||
+             (attack::attack(BISHOP, square, occupancy) & (pieces[BISHOP] | pieces[QUEEN]) & enemy) ||
+             (attack::attack(ROOK, square, occupancy) & (pieces[ROOK] | pieces[QUEEN]) & enemy));
+}
+
 void Move::print() const {
     std::cout << to_coordinates(source()) << " ";
     std::cout << to_coordinates(target()) << " ";
@@ -41,7 +41,6 @@ struct Move {
     [[nodiscard]] constexpr bool is_promote() const { return flags_i & 0x8; }
 
     [[nodiscard]] constexpr bool is_double() const { return flags_i == DOUBLE; }
-    [[nodiscard]] constexpr bool is_repeatable() const { return flags_i == QUIET; }
     [[nodiscard]] constexpr bool is_quiet() const { return flags_i == QUIET || flags_i == PQUIET; }
 
     [[nodiscard]] constexpr bool is_castle() const { return flags_i == CASTLEK || flags_i == CASTLEQ; }
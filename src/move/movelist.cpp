@@ -1,5 +1,6 @@
 #include "movelist.hpp"
 #include "piece.hpp"
+#include "profile.hpp"
 #include <iomanip>
 
 #define pawn_canPromote(color, source)                                                                       \
@@ -13,6 +14,8 @@
 using Type::PAWN;
 
 void MoveList::generate(const Board &board, bool attacks_only) {
+    PROFILE_ZONE(Generate);
+
     uint8_t src_i = 0, tgt_i = 0;
 
     const Color color = board.get_side(), colorOther = other(color);
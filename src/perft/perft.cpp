@@ -1,42 +1,68 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <iomanip>
-#include <semaphore>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 #include "attack.hpp"
 #include "board.hpp"
 #include "move.hpp"
 #include "movelist.hpp"
+#include "perf.hpp"
+#include "profile.hpp"
 #include "utils.hpp"
 
 // FEN debug positions
 #define tricky_position "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1 "
 
 enum {
-    THREAD_MAX = 64
+    THREAD_MAX = 64,
+    SPLIT_DEPTH = 3, // smaller subtrees aren't worth handing to another thread
+    HASH_SIZE = 64,  // megabytes of the node count cache
+    HASH_DEPTH = 2   // shallower subtrees are cheaper to count than to look up
 };
 
-class Perft {
+// node counts of subtrees by position and depth, shared by all threads without locks
+// an entry stores its data and the hash xor the data, a torn write then fails the check
+class PerftTable {
   public:
-    using semaphore_t = std::counting_semaphore<THREAD_MAX>;
-    Perft(semaphore_t &sem) : sem(sem) {}
-    void operator()(const Board &board_start, Move move, int depth) {
-        Board board = board_start;
-        if (!move.make(board)) return;
-        sem.acquire();
-        // debug(board_start, move, board);
-
-        if (depth > 1) {
-            test(board, depth - 1);
-        } else {
-            score(board, move);
-        }
+    PerftTable(U64 megabytes) {
+        while (size * 2 * sizeof(Entry) <= megabytes << 20)
+            size *= 2;
+        table = std::make_unique<Entry[]>(size);
+    }
 
-        mutex.acquire();
-        result += local;
-        mutex.release();
-        sem.release();
+    bool read(U64 hash, int depth, U64 &nodes) const {
+        const Entry &entry = table[hash & (size - 1)];
+        const U64 data = entry.data.load(std::memory_order_relaxed);
+        const U64 check = entry.check.load(std::memory_order_relaxed);
+        if ((check ^ data) != hash || (int)(data & 0xFF) != depth) return false;
+        nodes = data >> 8;
+        return true;
     }
 
+    void write(U64 hash, int depth, U64 nodes) {
+        Entry &entry = table[hash & (size - 1)];
+        const U64 data = nodes << 8 | depth;
+        entry.data.store(data, std::memory_order_relaxed);
+        entry.check.store(hash ^ data, std::memory_order_relaxed);
+    }
+
+  private:
+    struct Entry {
+        std::atomic<U64> check;
+        std::atomic<U64> data; // node count above the depth byte
+    };
+
+    U64 size = 1;
+    std::unique_ptr<Entry[]> table;
+};
+
+class Perft {
+  public:
     struct result_t {
         U64 node = 0;
 #ifdef USE_FULL_COUNT
@@ -59,19 +85,135 @@ class Perft {
         }
     };
 
-    static result_t result;
+    Perft(int thread_num, PerftTable *table) : workers(thread_num), table(table) {}
+
+    result_t operator()(const Board &board, int depth) {
+        pending = 1;
+        queued = 1;
+        idle = 0;
+        workers[0].tasks.push_back({board, depth});
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < (int)workers.size(); i++)
+            threads.emplace_back(&Perft::work, this, i);
+        for (auto &thread : threads)
+            thread.join();
+
+        result_t result;
+        for (const Worker &worker : workers)
+            result += worker.result;
+        return result;
+    }
 
   private:
-    void test(const Board &board, int depth) {
+    struct Task {
+        Board board;
+        int depth;
+    };
+
+    // owner takes the newest task from the back, thieves the oldest and largest from the front
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        result_t result;
+    };
+
+    void work(int index) {
+        Worker &worker = workers[index];
+        bool waiting = false;
+        while (pending) {
+            Task task;
+            if (!pop(worker, task) && !steal(index, task)) {
+                // woken by a split or the end, both notify under the lock so the wake up can't be missed
+                if (!waiting) idle++, waiting = true;
+                std::unique_lock<std::mutex> lock(sleep);
+                wake.wait(lock, [this]() { return queued || !pending; });
+                continue;
+            }
+            if (waiting) idle--, waiting = false;
+
+            // split while there is less work than workers, so the last large subtrees are shared as well
+            if (task.depth > SPLIT_DEPTH && (idle || pending < workers.size())) {
+                const MoveList list(task.board);
+                const std::lock_guard<std::mutex> lock(worker.mutex);
+                for (int i = 0; i < list.size(); i++) {
+                    Board copy = task.board;
+                    if (!list[i].make(copy)) continue;
+                    worker.tasks.push_back({copy, task.depth - 1});
+                    pending++;
+                    queued++;
+                }
+                notify();
+            } else {
+                test(worker.result, task.board, task.depth);
+            }
+            if (!--pending) notify();
+        }
+        if (waiting) idle--;
+    }
+
+    void notify() {
+        const std::lock_guard<std::mutex> lock(sleep);
+        wake.notify_all();
+    }
+
+    bool pop(Worker &worker, Task &task) {
+        const std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty()) return false;
+        task = worker.tasks.back();
+        worker.tasks.pop_back();
+        queued--;
+        return true;
+    }
+
+    bool steal(int index, Task &task) {
+        for (int i = 1; i < (int)workers.size(); i++) {
+            Worker &victim = workers[(index + i) % workers.size()];
+            const std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.tasks.empty()) continue;
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    void test(result_t &result, const Board &board, int depth) {
+        // only plain node counts are cached, the full count always walks the tree
+#ifndef USE_FULL_COUNT
+        const bool hashed = table && depth >= HASH_DEPTH;
+        U64 nodes = 0;
+        if (hashed && table->read(board.get_hash(), depth, nodes)) {
+            result.node += nodes;
+            return;
+        }
+        nodes = result.node;
+#endif
+
         const MoveList list(board);
+
+        // bulk counting, the last ply only needs the number of legal moves
+#ifndef USE_FULL_COUNT
+        if (depth == 1) {
+            for (int i = 0; i < list.size(); i++)
+                result.node += board.is_legal(list[i]);
+            return;
+        }
+#endif
+
         for (int i = 0; i < list.size(); i++) {
             Board copy = board;
             if (!list[i].make(copy)) continue;
             // debug(board, list[i], copy);
-            if (depth != 1) test(copy, depth - 1);
+            if (depth != 1) test(result, copy, depth - 1);
             else
-                score(copy, list[i]);
+                score(result, copy, list[i]);
         }
+
+#ifndef USE_FULL_COUNT
+        if (hashed) table->write(board.get_hash(), depth, result.node - nodes);
+#endif
     }
 
     void debug(const Board &before, Move move, const Board &after) {
@@ -80,66 +222,75 @@ class Perft {
         std::cout << std::setw(16) << std::hex << after.get_hash() << "\n";
     }
 
-    void score(const Board &board, Move move) {
-        local.node++;
+    void score(result_t &result, const Board &board, Move move) {
+        result.node++;
 #ifdef USE_FULL_COUNT
-        if (board.is_check()) local.check++;
-        if (move.is_capture()) local.capture++;
-        if (move.is_enpassant()) local.enpassant++;
-        if (move.is_castle()) local.castle++;
-        if (move.is_promote()) local.promote++;
+        if (board.is_check()) result.check++;
+        if (move.is_capture()) result.capture++;
+        if (move.is_enpassant()) result.enpassant++;
+        if (move.is_castle()) result.castle++;
+        if (move.is_promote()) result.promote++;
 #endif
     }
-    result_t local;
-    semaphore_t &sem;
-    static std::binary_semaphore mutex;
-};
 
-std::binary_semaphore Perft::mutex{1};
-Perft::result_t Perft::result;
+    std::vector<Worker> workers;
+    PerftTable *table;
+    std::atomic<U64> pending; // tasks not yet finished, queued or running
+    std::atomic<U64> queued;  // tasks waiting in a deque
+    std::atomic<int> idle;
 
-void perft_test(const char *fen, int depth, int thread_num) {
-    const Board board = Board(fen);
-    const MoveList list = MoveList(board);
-    std::vector<std::thread> threads(list.size());
-
-    Perft::semaphore_t sem(thread_num);
+    std::mutex sleep;
+    std::condition_variable wake;
+};
 
-    int index = 0;
-    for (int i = 0; i < list.size(); i++)
-        threads[index++] = std::thread(Perft(sem), board, list[i], depth);
+void perft_test(const char *fen, int depth, int thread_num, int hash, bool counters) {
+    const Board board = Board(fen);
+    std::unique_ptr<PerftTable> table(hash ? new PerftTable(hash) : nullptr);
 
-    for (auto &thread : threads)
-        thread.join();
+    perf::Counters perf;
+    perf.start();
+    const Perft::result_t result = Perft(thread_num, table.get())(board, depth);
+    perf.stop();
 
     std::cout << std::dec;
-    std::cout << "     Nodes: " << Perft::result.node << "\n";
+    std::cout << "     Nodes: " << result.node << "\n";
 #ifdef USE_FULL_COUNT
-    std::cout << "  Captures: " << Perft::result.capture << "\n";
-    std::cout << "Enpassants: " << Perft::result.enpassant << "\n";
-    std::cout << "   Castles: " << Perft::result.castle << "\n";
-    std::cout << "Promotions: " << Perft::result.promote << "\n";
-    std::cout << "    Checks: " << Perft::result.check << "\n";
+    std::cout << "  Captures: " << result.capture << "\n";
+    std::cout << "Enpassants: " << result.enpassant << "\n";
+    std::cout << "   Castles: " << result.castle << "\n";
+    std::cout << "Promotions: " << result.promote << "\n";
+    std::cout << "    Checks: " << result.check << "\n";
 #endif
+    if (counters) std::cout << perf;
 }
 
 void usage(const char *program) {
     std::cout << "Usage: " << program;
     std::cout << " [-h]";
+    std::cout << " [-p]";
+    std::cout << " [-v]";
+    std::cout << " [-H hash megabytes]";
     std::cout << " [-t thread number]";
     std::cout << " [-d depth]";
     std::cout << " [-f fen]" << std::endl;
 }
 
 int main(int argc, char *argv[]) {
-    int c = 0, depth = 1, thread_num = 1;
+    int c = 0, depth = 1, thread_num = 1, hash = HASH_SIZE;
+    bool counters = false;
     std::string s(start_position);
     const char *fen = s.data();
-    while ((c = getopt(argc, argv, "ht:f:d:")) != -1) {
+    while ((c = getopt(argc, argv, "hpvH:t:f:d:")) != -1) {
         switch (c) {
+        case 'p': counters = true; break;
+        case 'v': hash = 0; break; // verify the move generator, a hash collision can't hide a bug
+        case 'H':
+            hash = atoi(optarg);
+            if (hash < 0) abort();
+            break;
         case 't':
             thread_num = atoi(optarg);
-            if (thread_num <= 0 && thread_num > THREAD_MAX) abort();
+            if (thread_num <= 0 || thread_num > THREAD_MAX) abort();
             break;
         case 'f': fen = optarg; break;
         case 'd':
@@ -153,6 +304,7 @@ int main(int argc, char *argv[]) {
 
     attack::init();
     zobrist::init();
-    perft_test(fen, depth, thread_num);
+    perft_test(fen, depth, thread_num, hash, counters);
+    profile::print();
     return 0;
 }
@@ -10,30 +10,20 @@ class Random {
 
     constexpr U64 operator()(void) { return get_U64(); }
 
-    constexpr U32 get_U32(void) {
-        U32 number = state;
-
-        number ^= number << 13;
-        number ^= number >> 17;
-        number ^= number << 5;
-
-        return state = number;
-    }
+    constexpr U32 get_U32(void) { return get_U64() >> 32; }
 
+    // xorshift64*, the multiplication keeps the outputs linearly independent,
+    // xor of zobrist keys would otherwise span fewer than 64 bits
     constexpr U64 get_U64(void) {
-        U64 n1, n2, n3, n4;
-
-        n1 = (U64)(get_U32()) & C64(0xFFFF);
-        n2 = (U64)(get_U32()) & C64(0xFFFF);
-        n3 = (U64)(get_U32()) & C64(0xFFFF);
-        n4 = (U64)(get_U32()) & C64(0xFFFF);
-
-        return n1 | (n2 << 16) | (n3 << 32) | (n4 << 48);
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * C64(2685821657736338717);
     }
 
   private:
-    static const U32 default_seed = C32(1804289383);
-    U32 state = default_seed;
+    static const U64 default_seed = C64(1804289383);
+    U64 state = default_seed;
 };
 
 #endif
@@ -0,0 +1,119 @@
+#ifndef STELLAR_PERF_H
+#define STELLAR_PERF_H
+
+#include <array>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace perf {
+
+// hardware counters of this thread and the threads it starts, through perf_event_open
+// counters the kernel refuses, as it does in most containers, are reported as unavailable
+class Counters {
+  public:
+    Counters(const Counters &) = delete;
+    Counters &operator=(const Counters &) = delete;
+
+    Counters() {
+#ifdef __linux__
+        for (Event &event : events) {
+            perf_event_attr attr = {};
+            attr.size = sizeof(attr);
+            attr.type = event.type;
+            attr.config = event.config;
+            attr.disabled = 1;
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            event.fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+#endif
+    }
+
+    ~Counters() {
+#ifdef __linux__
+        for (const Event &event : events)
+            if (event.fd != -1) close(event.fd);
+#endif
+    }
+
+    void start() {
+#ifdef __linux__
+        for (const Event &event : events) {
+            if (event.fd == -1) continue;
+            ioctl(event.fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(event.fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    void stop() {
+#ifdef __linux__
+        for (Event &event : events) {
+            if (event.fd == -1) continue;
+            ioctl(event.fd, PERF_EVENT_IOC_DISABLE, 0);
+
+            // value, time enabled and time running, scaled up if the counter was multiplexed
+            uint64_t data[3] = {0};
+            if (read(event.fd, data, sizeof(data)) != sizeof(data) || !data[2]) continue;
+            event.value = data[0] * ((double)data[1] / data[2]);
+            event.counted = true;
+        }
+#endif
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const Counters &counters) {
+        bool counted = false;
+        for (const Event &event : counters.events)
+            counted |= event.counted;
+        if (!counted) return os << std::setw(13) << "Counters" << ": unavailable\n";
+
+        for (const Event &event : counters.events) {
+            os << std::setw(13) << event.name << ": ";
+            if (event.counted) os << event.value << "\n";
+            else
+                os << "unavailable\n";
+        }
+        return os;
+    }
+
+  private:
+    struct Event {
+        const char *name;
+        uint32_t type;
+        uint64_t config;
+        int fd = -1;
+        bool counted = false;
+        uint64_t value = 0;
+    };
+
+#ifdef __linux__
+    static constexpr uint64_t cache_miss(uint64_t cache) {
+        return cache | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+    }
+
+    std::array<Event, 6> events = {{
+        {"Cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {"Instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {"L1d misses", PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D)},
+        {"LLC misses", PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL)},
+        {"Branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {"dTLB misses", PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB)},
+    }};
+#else
+    std::array<Event, 0> events;
+#endif
+};
+
+} // namespace perf
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef STELLAR_PROFILE_H
+#define STELLAR_PROFILE_H
+
+#ifdef USE_PROFILE
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// scoped timers for the hot paths
+namespace profile {
+
+enum Index {
+    Generate,
+    Make,
+    Evaluate,
+    TTRead,
+    TTWrite,
+    Ordering,
+    COUNT
+};
+
+inline constexpr const char *names[COUNT] = {
+    "Generate", "Make", "Evaluate", "TT read", "TT write", "Ordering",
+};
+
+struct Counter {
+    uint64_t cycles = 0;
+    uint64_t calls = 0;
+};
+
+using counters_t = std::array<Counter, COUNT>;
+
+inline std::mutex mutex;
+inline counters_t total;
+
+inline void merge(counters_t &counters) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    for (int i = 0; i < COUNT; i++) {
+        total[i].cycles += counters[i].cycles;
+        total[i].calls += counters[i].calls;
+    }
+    counters = counters_t();
+}
+
+// each thread counts on its own and hands the result over when it exits
+struct Local {
+    counters_t counters;
+    ~Local() { merge(counters); }
+};
+
+inline thread_local Local local;
+
+// time stamp counter, or nanoseconds where there is none
+inline uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_MSC_VER)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+class Zone {
+  public:
+    Zone(const Zone &) = delete;
+    Zone &operator=(const Zone &) = delete;
+
+    Zone(Index index) : index(index), start(cycles()) {}
+    ~Zone() {
+        Counter &counter = local.counters[index];
+        counter.cycles += cycles() - start;
+        counter.calls++;
+    }
+
+  private:
+    const Index index;
+    const uint64_t start;
+};
+
+// threads still running are left out, the calling one is included
+inline void print() {
+    merge(local.counters);
+
+    uint64_t sum = 0;
+    for (const Counter &counter : total)
+        sum += counter.cycles;
+
+    std::cout << "Profile: " << std::endl;
+    for (int i = 0; i < COUNT; i++) {
+        const Counter &counter = total[i];
+        std::cout << "\t" << std::left << std::setw(10) << names[i] << std::right;
+        std::cout << std::setw(14) << counter.calls << " calls";
+        std::cout << std::setw(16) << counter.cycles << " cycles";
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << std::setw(10) << (counter.calls ? (double)counter.cycles / counter.calls : 0) << " per call";
+        std::cout << std::setw(7) << (sum ? 100.0 * counter.cycles / sum : 0) << "%" << std::endl;
+    }
+}
+
+} // namespace profile
+
+// times the rest of the enclosing scope
+#define PROFILE_ZONE(index) const profile::Zone profile_zone(profile::index)
+
+#else
+
+// without USE_PROFILE the zones compile to nothing
+#define PROFILE_ZONE(index)
+
+namespace profile {
+
+inline void print() {}
+
+} // namespace profile
+
+#endif
+#endif
@@ -1,6 +1,7 @@
 #ifndef STELLAR_REPETITION_H
 #define STELLAR_REPETITION_H
 
+#include <algorithm>
 #include <iostream>
 #include <vector>
 
@@ -12,17 +13,27 @@ class Table {
   public:
     Table() = default;
 
-    [[nodiscard]] bool is_repetition(const U64 hash) const {
-        for (int i = repetitions.size() - 1; i >= 0; i--) {
+    // only positions since the last irreversible move, an even number of plies back, can repeat
+    [[nodiscard]] bool is_repetition(const U64 hash, int halfmove) const {
+        const int end = std::max<int>(repetitions.size() - halfmove, 0);
+        for (int i = repetitions.size() - 2; i >= end; i -= 2) {
             if (repetitions[i] == hash) return true;
-            if (repetitions[i] == hashNull) return false;
+        }
+        return false;
+    }
+
+    // can a single reversible move reach a position an odd number of plies back
+    template <typename Reversible>
+    [[nodiscard]] bool is_cycle(const U64 hash, int halfmove, Reversible reversible) const {
+        const int end = std::max<int>(repetitions.size() - halfmove, 0);
+        for (int i = repetitions.size() - 3; i >= end; i -= 2) {
+            if (reversible(hash ^ repetitions[i])) return true;
         }
         return false;
     }
 
     void pop() { repetitions.pop_back(); }
     void clear() { repetitions.clear(); }
-    void push_null() { repetitions.push_back(hashNull); }
     void push_hash(U64 hash) { repetitions.push_back(hash); }
 
     friend std::ostream &operator<<(std::ostream &os, const Table &rtable) {
@@ -33,8 +44,6 @@ class Table {
 
   private:
     std::vector<U64> repetitions;
-
-    const static int hashNull = 0;
 };
 
 } // namespace repetition
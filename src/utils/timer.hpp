@@ -2,14 +2,18 @@
 #define STELLAR_TIME_H
 
 #include <chrono>
+#include <cstdint>
 
 namespace timer {
 
-inline uint32_t get_ms() {
-    const auto duration = std::chrono::system_clock::now().time_since_epoch();
-    return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+// monotonic, wall clock adjustments can't make it jump
+inline uint64_t get_us() {
+    const auto duration = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
 }
 
+inline uint64_t get_ms() { return get_us() / 1000; }
+
 } // namespace timer
 
 #endif